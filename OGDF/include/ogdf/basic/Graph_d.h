@@ -654,6 +654,16 @@ public:
 	 */
 	//@{
 
+	//! Prepares the creation of \a nNodes nodes and \a nEdges edges in one arena.
+	/**
+	 * The nodes, edges and adjacency entries created next by the calling thread are
+	 * taken in index order from a single arena of the memory pool, so that iterating
+	 * over them and walking adjacency lists reads memory sequentially. Meant for
+	 * graphs that are built once and then only traversed. Node and edge arrays are
+	 * enlarged once for the reserved sizes.
+	 */
+	void reserveContiguous(int nNodes, int nEdges);
+
 	//! Creates a new node and returns it.
 	node newNode();
 
@@ -0,0 +1,130 @@
+/** \file
+ * \brief Declaration of a single pass GML reader for MetaCarvel graphs.
+ *
+ * \author MetaCarvel developers
+ *
+ * \par License:
+ * This file is part of the Open Graph Drawing Framework (OGDF).
+ *
+ * \par
+ * Copyright (C)<br>
+ * See README.txt in the root directory of the OGDF installation for details.
+ *
+ * \par
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * Version 2 or 3 as published by the Free Software Foundation;
+ * see the file LICENSE.txt included in the packaging of this file
+ * for details.
+ *
+ * \par
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * \par
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * \see  http://www.gnu.org/copyleft/gpl.html
+ ***************************************************************/
+
+#ifdef _MSC_VER
+#pragma once
+#endif
+
+
+#ifndef OGDF_GML_STREAM_PARSER_H
+#define OGDF_GML_STREAM_PARSER_H
+
+
+#include <ogdf/basic/Graph.h>
+#include <ogdf/basic/NodeArray.h>
+#include <ogdf/basic/EdgeArray.h>
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace ogdf {
+
+
+//! Reads GML in a single pass, keeping the attributes of MetaCarvel graphs.
+/**
+ * GmlParser first builds the object tree of the whole file and then the graph
+ * from it. This parser creates nodes and edges as their lists close, so memory
+ * is proportional to the graph. Besides \c id, \c source and \c target, the
+ * node attributes \c label, \c orientation and \c length and the edge
+ * attributes \c orientation, \c mean, \c stdev and \c bsize are kept. Numeric
+ * attributes may be quoted, as in \c oriented.gml. Other keys are skipped
+ * together with any lists they hold.
+ */
+class OGDF_EXPORT GmlStreamParser {
+public:
+	GmlStreamParser(std::istream &is);
+
+	//! Clears \a G and reads the graph into it, returns false on malformed input.
+	bool read(Graph &G);
+
+	//! Returns true if the graph was declared \c directed.
+	bool directed() const { return m_directed; }
+
+	const NodeArray<string> &label() const { return m_label; }
+	const NodeArray<string> &nodeOrientation() const { return m_nodeOrientation; }
+	const NodeArray<int> &length() const { return m_length; }
+
+	const EdgeArray<string> &edgeOrientation() const { return m_edgeOrientation; }
+	const EdgeArray<double> &mean() const { return m_mean; }
+	const EdgeArray<double> &stdev() const { return m_stdev; }
+	const EdgeArray<int> &bsize() const { return m_bsize; }
+
+private:
+	enum Token { tokKey, tokNumber, tokString, tokListBegin, tokListEnd, tokEOF, tokError };
+
+	//! An edge whose source or target node was not read yet.
+	struct PendingEdge {
+		int source, target;
+		string orientation;
+		double mean, stdev;
+		int bsize;
+	};
+
+	std::istream &m_is;
+	char m_buffer[1 << 16];
+	size_t m_pos, m_size;
+	int m_line;
+	string m_text; //!< the key, number or string of the last token
+
+	bool m_directed;
+	std::unordered_map<int, node> m_idNode;
+	std::vector<PendingEdge> m_pending;
+
+	NodeArray<string> m_label;
+	NodeArray<string> m_nodeOrientation;
+	NodeArray<int> m_length;
+	EdgeArray<string> m_edgeOrientation;
+	EdgeArray<double> m_mean;
+	EdgeArray<double> m_stdev;
+	EdgeArray<int> m_bsize;
+
+	int peekChar();
+	Token nextToken();
+	bool readValue(Token &t);
+	bool skipList();
+	bool readGraph(Graph &G);
+	bool readNode(Graph &G);
+	bool readEdge(Graph &G);
+	void newEdge(Graph &G, node s, node t, const PendingEdge &attr);
+	void error(const char *str);
+};
+
+
+} // end namespace ogdf
+
+
+#endif
@@ -96,6 +96,9 @@ public:
 	static void flushPool() { }
 	static void flushPool(uint16_t /* nBytes */) { }
 
+	//! Does nothing, every element is allocated on its own.
+	static void reserve(size_t /* nBytes */, int /* n */) { }
+
 	//! Always returns 0, since no blocks are allocated.
 	static size_t memoryAllocatedInBlocks() { return 0; }
 
@@ -44,6 +44,7 @@
 #include <ogdf/basic/System.h>
 
 #ifndef OGDF_MEMORY_POOL_NTS
+#include <atomic>
 #include <mutex>
 #ifdef OGDF_NO_COMPILER_TLS
 #include <pthread.h>
@@ -70,6 +71,16 @@ namespace ogdf {
  * It is also possible to make the usual \c new operator behave the same
  * way (throwing an InsufficientMemoryException) by defining the
  * macro \c #OGDF_MALLOC_NEW_DELETE in a class declaration.
+ *
+ * <H3>Threads:</H3>
+ *
+ * Every thread allocates from and frees to free lists of its own, without
+ * synchronization. When a list runs empty, the thread takes a whole slab
+ * (a chain of free elements, one block's worth when freshly cut) from a
+ * lock-free stack per size class, and flushPool() gives its lists back to
+ * these stacks in slabs. Only cutting new blocks from system memory takes a
+ * lock. Threads allocating from the pool should call flushPool() before they
+ * exit, as ogdf::Thread does.
  */
 
 class PoolMemoryAllocator
@@ -89,15 +100,23 @@ class PoolMemoryAllocator
 	struct PoolElement;
 	struct BlockChain;
 	typedef BlockChain *BlockChainPtr;
+	struct ArenaChain;
 
 public:
 	enum {
-		eMinBytes = sizeof(MemElemPtr),
+		eMinBytes = sizeof(MemElemEx),
 		eTableSize = 256,
 		eBlockSize = 8192,
 		ePoolVectorLength = 15
 	};
 
+	//! Counters of one size class, see statistics().
+	struct SizeClassStatistics {
+		size_t m_blocks;   //!< blocks cut into elements of this size
+		size_t m_refills;  //!< slabs taken from the global pool by threads
+		size_t m_flushes;  //!< slabs given back to the global pool by threads
+	};
+
 	PoolMemoryAllocator() { }
 	~PoolMemoryAllocator() { }
 
@@ -130,6 +149,15 @@ public:
 
 	static OGDF_EXPORT void flushPool();
 
+	//! Puts \a n elements of size \a nBytes from a single arena at the front of the thread's free list.
+	/**
+	 * The next \a n allocations of that size return the arena's elements in address
+	 * order, so that a structure built right after, e.g. by Graph::reserveContiguous(),
+	 * lies sequentially in memory. Once freed they are ordinary pool elements, the
+	 * arena itself is only returned to the system by cleanup().
+	 */
+	static OGDF_EXPORT void reserve(size_t nBytes, int n);
+
 	//! Returns the total amount of memory (in bytes) allocated from the system.
 	static OGDF_EXPORT size_t memoryAllocatedInBlocks();
 
@@ -147,6 +175,9 @@ public:
 	 */
 	static OGDF_EXPORT void defrag();
 
+	//! Returns the counters of size class \a nBytes, since the start of the program.
+	static OGDF_EXPORT SizeClassStatistics statistics(size_t nBytes);
+
 private:
 	static inline void enterCS() {
 #ifndef OGDF_MEMORY_POOL_NTS
@@ -172,6 +203,12 @@ private:
 
 	static void *fillPool(MemElemPtr &pFreeBytes, uint16_t nBytes);
 
+#ifndef OGDF_MEMORY_POOL_NTS
+	// lock-free stack of slabs, see PoolElement
+	static void pushSlabs(PoolElement &pe, MemElemExPtr pFirst, MemElemExPtr pLast, int n);
+	static MemElemExPtr popSlab(PoolElement &pe);
+#endif
+
 	static MemElemPtr allocateBlock();
 	static void makeSlices(MemElemPtr p, int nWords, int nSlices);
 
@@ -179,6 +216,8 @@ private:
 
 	static PoolElement s_pool[eTableSize];
 	static BlockChainPtr s_blocks;
+	static ArenaChain *s_arenas;
+	static size_t s_arenaBytes;
 
 #ifdef OGDF_DEBUG
 	static size_t s_nettoAlloc;
@@ -46,6 +46,7 @@
 #include <ogdf/basic/NodeArray.h>
 #include <ogdf/basic/EdgeArray.h>
 #include <ogdf/basic/Array.h>
+#include <ogdf/basic/ArrayBuffer.h>
 #include <ogdf/basic/BoundedStack.h>
 
 
@@ -168,19 +169,67 @@ private:
 	void printOs(edge e);
 	void printStacks();
 
+	// entry of a HIGHPT list; the lists of all nodes share one buffer
+	struct HighEntry {
+		int  m_num;          // number of the source of a frond entering m_owner
+		int  m_next, m_prev; // neighbours in the list, -1 at its ends
+		node m_owner;        // node whose list contains the entry
+	};
+
+	// returns the first edge in the adjacency list of v
+	edge firstAdj(node v) {
+		int &i = m_ADJ_first[v];
+		while (m_ADJ[i] == nullptr) ++i;
+		return m_ADJ[i];
+	}
+
+	// removes e from the adjacency list of its source
+	void delAdj(edge e) {
+		m_ADJ[m_IN_ADJ[e]] = nullptr;
+	}
+
+	// appends h to the HIGHPT list of v, returns the new entry
+	int HIGH_pushBack(node v, int h) {
+		int i = HIGH_new(v, h);
+		m_HIGH[i].m_prev = m_HIGH_last[v];
+		if (m_HIGH_last[v] < 0) m_HIGH_first[v] = i;
+		else m_HIGH[m_HIGH_last[v]].m_next = i;
+		return m_HIGH_last[v] = i;
+	}
+
+	// prepends h to the HIGHPT list of v, returns the new entry
+	int HIGH_pushFront(node v, int h) {
+		int i = HIGH_new(v, h);
+		m_HIGH[i].m_next = m_HIGH_first[v];
+		if (m_HIGH_first[v] < 0) m_HIGH_last[v] = i;
+		else m_HIGH[m_HIGH_first[v]].m_prev = i;
+		return m_HIGH_first[v] = i;
+	}
+
+	int HIGH_new(node v, int h) {
+		HighEntry x = { h, -1, -1, v };
+		m_HIGH.push(x);
+		return m_HIGH.size()-1;
+	}
+
 	// returns high(v) value
 	int high(node v) {
-		return (m_HIGHPT[v].empty()) ? 0 : m_HIGHPT[v].front();
+		return (m_HIGH_first[v] < 0) ? 0 : m_HIGH[m_HIGH_first[v]].m_num;
 	}
 
 	void delHigh(edge e) {
-		ListIterator<int> it = m_IN_HIGH[e];
-		if (it.valid()) {
-			node v = e->target();
-			m_HIGHPT[v].del(it);
+		int i = m_IN_HIGH[e];
+		if (i >= 0) {
+			const HighEntry &x = m_HIGH[i];
+			if (x.m_prev < 0) m_HIGH_first[x.m_owner] = x.m_next;
+			else m_HIGH[x.m_prev].m_next = x.m_next;
+			if (x.m_next < 0) m_HIGH_last[x.m_owner] = x.m_prev;
+			else m_HIGH[x.m_next].m_prev = x.m_prev;
+			m_IN_HIGH[e] = -1;
 		}
 	}
 
+
 	NodeArray<int>   m_NUMBER; // (first) dfs-number of v
 	NodeArray<int>   m_LOWPT1;
 	NodeArray<int>   m_LOWPT2;
@@ -189,13 +238,16 @@ private:
 	Array<node>      m_NODEAT; // node with number i
 	NodeArray<node> m_FATHER;  // father of v in palm tree
 	EdgeArray<edgeType> m_TYPE; // type of edge e
-	NodeArray<List<edge> > m_A; // adjacency list of v
+	Array<edge>     m_ADJ;     // adjacency lists in one array, the list of v in slots [ADJ_first[v],ADJ_last[v]), nullptr if deleted
+	NodeArray<int>  m_ADJ_first; // first slot of v (advanced past deleted slots)
+	NodeArray<int>  m_ADJ_last;  // one past the last slot of v
 	NodeArray<int>  m_NEWNUM;  // (second) dfs-number of v
 	EdgeArray<bool> m_START;   // edge starts a path
 	NodeArray<edge> m_TREE_ARC; // tree arc entering v
-	NodeArray<List<int> > m_HIGHPT;	// list of fronds entering v in the order they are visited
-	EdgeArray<ListIterator<edge> > m_IN_ADJ;	// pointer to element in adjacency list containing e
-	EdgeArray<ListIterator<int> >  m_IN_HIGH;	// pointer to element in HIGHPT list containing e
+	ArrayBuffer<HighEntry> m_HIGH;	// entries of the HIGHPT lists
+	NodeArray<int>  m_HIGH_first, m_HIGH_last;	// HIGHPT list of fronds entering v in the order they are visited, -1 if empty
+	EdgeArray<int>  m_IN_ADJ;	// slot in m_ADJ containing e, -1 if none
+	EdgeArray<int>  m_IN_HIGH;	// entry in m_HIGH containing e, -1 if none
 	BoundedStack<edge> m_ESTACK; // stack of currently active edges
 
 	node m_start;     // start node of dfs traversal
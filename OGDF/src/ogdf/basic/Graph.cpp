@@ -453,6 +453,39 @@ void Graph::constructInitByActiveNodes(
 
 
 
+void Graph::reserveContiguous(int nNodes, int nEdges)
+{
+	int nodeTableSize = nextPower2(m_nodeArrayTableSize, m_nodeIdCount + nNodes - 1);
+	if (nodeTableSize > m_nodeArrayTableSize) {
+		m_nodeArrayTableSize = nodeTableSize;
+		for(NodeArrayBase *nab : m_regNodeArrays)
+			nab->enlargeTable(m_nodeArrayTableSize);
+	}
+	int edgeTableSize = nextPower2(m_edgeArrayTableSize, m_edgeIdCount + nEdges - 1);
+	if (edgeTableSize > m_edgeArrayTableSize) {
+		m_edgeArrayTableSize = edgeTableSize;
+		for(EdgeArrayBase *eab : m_regEdgeArrays)
+			eab->enlargeTable(m_edgeArrayTableSize);
+		for(AdjEntryArrayBase *aab : m_regAdjArrays)
+			aab->enlargeTable(m_edgeArrayTableSize << 1);
+	}
+
+	// element types of the same size share a free list and thus one arena
+	size_t sizes[3] = { sizeof(NodeElement), sizeof(EdgeElement), sizeof(AdjElement) };
+	int counts[3] = { nNodes, nEdges, 2*nEdges };
+	for(int i = 0; i < 3; ++i) {
+		for(int j = 0; j < i; ++j) {
+			if (sizes[j] == sizes[i]) {
+				counts[j] += counts[i];
+				counts[i] = 0;
+			}
+		}
+	}
+	for(int i = 0; i < 3; ++i)
+		OGDF_ALLOCATOR::reserve(sizes[i], counts[i]);
+}
+
+
 node Graph::newNode()
 {
 	if (m_nodeIdCount == m_nodeArrayTableSize) {
@@ -36,14 +36,24 @@
 
 #include <ogdf/basic/basic.h>
 
+#include <vector>
+
 
 namespace ogdf {
 
 
+// The global pool of a size class. Slabs are chains of free elements linked through m_next, and
+// the stack links their first elements through m_down.
 struct PoolMemoryAllocator::PoolElement
 {
-	MemElemPtr m_gp;
-	int        m_size;
+#ifndef OGDF_MEMORY_POOL_NTS
+	std::atomic<uint64_t> m_top;  // top slab and ABA tag, see packTop()
+	std::atomic<int>      m_size; // elements in all slabs
+	std::atomic<size_t>   m_blocks, m_refills, m_flushes;
+#else
+	int    m_size;
+	size_t m_blocks, m_refills, m_flushes;
+#endif
 };
 
 struct PoolMemoryAllocator::BlockChain
@@ -52,9 +62,18 @@ struct PoolMemoryAllocator::BlockChain
 	BlockChain *m_next;
 };
 
+// header of an arena of reserve(), followed by its elements
+struct PoolMemoryAllocator::ArenaChain
+{
+	ArenaChain *m_next;
+	size_t      m_bytes;
+};
+
 
 PoolMemoryAllocator::PoolElement PoolMemoryAllocator::s_pool[eTableSize];
 PoolMemoryAllocator::BlockChainPtr PoolMemoryAllocator::s_blocks;
+PoolMemoryAllocator::ArenaChain *PoolMemoryAllocator::s_arenas;
+size_t PoolMemoryAllocator::s_arenaBytes;
 
 #ifdef OGDF_DEBUG
 size_t PoolMemoryAllocator::s_nettoAlloc;
@@ -75,6 +94,55 @@ OGDF_DECL_THREAD PoolMemoryAllocator::MemElemPtr PoolMemoryAllocator::s_tp[eTabl
 #endif
 
 
+#ifndef OGDF_MEMORY_POOL_NTS
+
+// The top of a slab stack packs the pointer with a tag that changes on every push and pop, so that
+// a pop fails when the top was popped and pushed again since it was read (ABA). User space
+// pointers fit into the low 48 bits on 64 bit platforms.
+static const int c_tagShift = sizeof(void*) == 4 ? 32 : 48;
+static const uint64_t c_pointerMask = (uint64_t(1) << c_tagShift) - 1;
+
+static inline uint64_t packTop(void *p, uint64_t tag)
+{
+	return (tag << c_tagShift) | (uint64_t(uintptr_t(p)) & c_pointerMask);
+}
+
+template<class T> static inline T *topPointer(uint64_t top)
+{
+	return reinterpret_cast<T *>(uintptr_t(top & c_pointerMask));
+}
+
+
+// pushes the slabs from pFirst to pLast, chained through m_down, holding n elements together
+void PoolMemoryAllocator::pushSlabs(PoolElement &pe, MemElemExPtr pFirst, MemElemExPtr pLast, int n)
+{
+	uint64_t top = pe.m_top.load(std::memory_order_relaxed);
+	do {
+		pLast->m_down = topPointer<MemElemEx>(top);
+	} while(!pe.m_top.compare_exchange_weak(top, packTop(pFirst, (top >> c_tagShift) + 1),
+		std::memory_order_release, std::memory_order_relaxed));
+	pe.m_size += n;
+}
+
+
+PoolMemoryAllocator::MemElemExPtr PoolMemoryAllocator::popSlab(PoolElement &pe)
+{
+	uint64_t top = pe.m_top.load(std::memory_order_acquire);
+	MemElemExPtr pSlab;
+	do {
+		pSlab = topPointer<MemElemEx>(top);
+		if(pSlab == nullptr)
+			return nullptr;
+		// another thread may take pSlab meanwhile, then m_down is stale, but blocks are only
+		// freed by cleanup() and the exchange fails on the changed tag
+	} while(!pe.m_top.compare_exchange_weak(top, packTop(pSlab->m_down, (top >> c_tagShift) + 1),
+		std::memory_order_acquire, std::memory_order_acquire));
+	return pSlab;
+}
+
+#endif
+
+
 void PoolMemoryAllocator::init()
 {
 #ifndef OGDF_MEMORY_POOL_NTS
@@ -112,6 +180,13 @@ void PoolMemoryAllocator::cleanup()
 		p = pNext;
 	}
 
+	ArenaChain *pArena = s_arenas;
+	while(pArena != nullptr) {
+		ArenaChain *pNext = pArena->m_next;
+		free(pArena);
+		pArena = pNext;
+	}
+
 #ifndef OGDF_MEMORY_POOL_NTS
 #ifdef OGDF_NO_COMPILER_TLS
 	pthread_key_delete(s_tpKey);
@@ -160,6 +235,8 @@ void PoolMemoryAllocator::deallocateList(size_t nBytes, void *pHead, void *pTail
 
 
 
+// The thread's free lists go to the global pool in slabs of up to a block's worth of elements, all
+// slabs of a list at once and in list order, so that the elements freed last are taken first.
 void PoolMemoryAllocator::flushPool()
 {
 #ifndef OGDF_MEMORY_POOL_NTS
@@ -169,28 +246,34 @@ void PoolMemoryAllocator::flushPool()
 #else
 		MemElemPtr &pHead = s_tp[nBytes];
 #endif
-		if(pHead != nullptr) {
-			MemElemPtr pTail = pHead;
+		if(pHead == nullptr)
+			continue;
+
+		PoolElement &pe = s_pool[nBytes];
+		int nSlices = slicesPerBlock(max(nBytes,(uint16_t)eMinBytes));
+		MemElemExPtr pFirst = reinterpret_cast<MemElemExPtr>(pHead), pLast = nullptr;
+		int total = 0;
+
+		while(pHead != nullptr) {
+			MemElemPtr pSlab = pHead, pTail = pHead;
 			int n = 1;
 
-			while(pTail->m_next != nullptr) {
+			while(n < nSlices && pTail->m_next != nullptr) {
 				pTail = pTail->m_next;
 				++n;
 			}
 
-			MemElemPtr pOldHead = pHead;
-			pHead = nullptr;
-
-			enterCS();
-
-			PoolElement &pe = s_pool[nBytes];
-
-			pTail->m_next = pe.m_gp;
-			pe.m_gp = pOldHead;
-			pe.m_size += n;
+			pHead = pTail->m_next;
+			pTail->m_next = nullptr;
 
-			leaveCS();
+			if(pLast != nullptr)
+				pLast->m_down = reinterpret_cast<MemElemExPtr>(pSlab);
+			pLast = reinterpret_cast<MemElemExPtr>(pSlab);
+			total += n;
+			pe.m_flushes++;
 		}
+
+		pushSlabs(pe, pFirst, pLast, total);
 	}
 #endif
 }
@@ -201,35 +284,36 @@ void *PoolMemoryAllocator::fillPool(MemElemPtr &pFreeBytes, uint16_t nBytes)
 	int nWords;
 	int nSlices = slicesPerBlock(max(nBytes,(uint16_t)eMinBytes),nWords);
 
+	PoolElement &pe = s_pool[nBytes];
+
 #ifdef OGDF_MEMORY_POOL_NTS
 	pFreeBytes = allocateBlock();
 #ifdef OGDF_DEBUG
 	s_nettoAlloc += nWords * nSlices;
 #endif
+	pe.m_blocks++;
 	makeSlices(pFreeBytes, nWords, nSlices);
 
 #else
-	enterCS();
-
-	PoolElement &pe = s_pool[nBytes];
-	if(pe.m_size >= nSlices) {
-		MemElemPtr p = pFreeBytes = pe.m_gp;
-		for(int i = 1; i < nSlices; ++i)
-			p = p->m_next;
-
-		pe.m_gp = p->m_next;
-		pe.m_size -= nSlices;
-
-		leaveCS();
+	MemElemExPtr pSlab = popSlab(pe);
+	if(pSlab != nullptr) {
+		int n = 0;
+		for(MemElemPtr p = reinterpret_cast<MemElemPtr>(pSlab); p != nullptr; p = p->m_next)
+			++n;
+		pe.m_size -= n;
+		pe.m_refills++;
 
-		p->m_next = nullptr;
+		pFreeBytes = reinterpret_cast<MemElemPtr>(pSlab);
 
 	} else {
+		// only cutting new blocks takes the lock, it guards the block chain
+		enterCS();
 		pFreeBytes = allocateBlock();
 #ifdef OGDF_DEBUG
 		s_nettoAlloc += nWords * nSlices;
 #endif
 		leaveCS();
+		pe.m_blocks++;
 
 		makeSlices(pFreeBytes, nWords, nSlices);
 	}
@@ -241,6 +325,34 @@ void *PoolMemoryAllocator::fillPool(MemElemPtr &pFreeBytes, uint16_t nBytes)
 }
 
 
+void PoolMemoryAllocator::reserve(size_t nBytes, int n)
+{
+	if(n < 2 || !checkSize(nBytes))
+		return;
+
+	int nWords;
+	slicesPerBlock(max(uint16_t(nBytes),(uint16_t)eMinBytes),nWords);
+	size_t bytes = sizeof(ArenaChain) + size_t(n) * nWords * __SIZEOF_POINTER__;
+
+	ArenaChain *pArena = static_cast<ArenaChain *>( malloc(bytes) );
+	if (pArena == nullptr) OGDF_THROW(InsufficientMemoryException);
+	pArena->m_bytes = bytes;
+
+	enterCS();
+	pArena->m_next = s_arenas;
+	s_arenas = pArena;
+	s_arenaBytes += bytes;
+#ifdef OGDF_DEBUG
+	s_nettoAlloc += size_t(n) * nWords;
+#endif
+	leaveCS();
+
+	MemElemPtr pHead = reinterpret_cast<MemElemPtr>(pArena + 1);
+	makeSlices(pHead, nWords, n);
+	deallocateList(nBytes, pHead, pHead + size_t(n-1) * nWords);
+}
+
+
 PoolMemoryAllocator::MemElemPtr
 PoolMemoryAllocator::allocateBlock()
 {
@@ -271,9 +383,11 @@ size_t PoolMemoryAllocator::memoryAllocatedInBlocks()
 	for (BlockChainPtr p = s_blocks; p != nullptr; p = p->m_next)
 		++nBlocks;
 
+	size_t nBytes = nBlocks * eBlockSize + s_arenaBytes;
+
 	leaveCS();
 
-	return nBlocks * eBlockSize;
+	return nBytes;
 }
 
 
@@ -318,41 +432,59 @@ size_t PoolMemoryAllocator::memoryInThreadFreeList()
 }
 
 
+// Takes all slabs of a size class at once and puts them back sorted, in slabs of a block's worth.
+// Slabs that threads give back meanwhile start a new stack and are left as they are.
 void PoolMemoryAllocator::defrag()
 {
-	enterCS();
-
-	int maxSize = 0;
-	for(int sz = 1; sz < eTableSize; ++sz) {
-		int size = s_pool[sz].m_size;
-		maxSize = max(maxSize, size);
-	}
-
-	if(maxSize > 1) {
-		MemElemPtr *a = new MemElemPtr[maxSize];
+#ifndef OGDF_MEMORY_POOL_NTS
+	std::vector<MemElemPtr> a;
 
-		for(int sz = 1; sz < eTableSize; ++sz)
+	for(uint16_t sz = 1; sz < eTableSize; ++sz)
+	{
+		PoolElement &pe = s_pool[sz];
+		uint64_t top = pe.m_top.load(std::memory_order_acquire);
+		while(!pe.m_top.compare_exchange_weak(top, packTop(nullptr, (top >> c_tagShift) + 1),
+			std::memory_order_acquire, std::memory_order_acquire)) { }
+
+		a.clear();
+		for(MemElemExPtr pSlab = topPointer<MemElemEx>(top); pSlab != nullptr; pSlab = pSlab->m_down)
+			for(MemElemPtr p = reinterpret_cast<MemElemPtr>(pSlab); p != nullptr; p = p->m_next)
+				a.push_back(p);
+		int n = int(a.size());
+		pe.m_size -= n;
+		std::sort(a.begin(), a.end());
+
+		int nSlices = slicesPerBlock(max(sz,(uint16_t)eMinBytes));
+		MemElemExPtr pFirst = nullptr, pLast = nullptr;
+		for(int first = 0; first < n; first += nSlices)
 		{
-			PoolElement &pe = s_pool[sz];
-			int n = pe.m_size;
-			if(n > 1)
-			{
-				int i = 0;
-				for(MemElemPtr p = pe.m_gp; p != nullptr; p = p->m_next)
-					a[i++] = p;
-				OGDF_ASSERT(i == n);
-				std::sort(a, a+n);
-				pe.m_gp = a[0];
-				for(int i = 0; i < n-1; ++i) {
-					a[i]->m_next = a[i+1];
-				}
-				a[n-1]->m_next = nullptr;
-			}
+			int last = min(n, first + nSlices) - 1;
+			for(int i = first; i < last; ++i)
+				a[i]->m_next = a[i+1];
+			a[last]->m_next = nullptr;
+
+			MemElemExPtr pSlab = reinterpret_cast<MemElemExPtr>(a[first]);
+			if(pLast != nullptr)
+				pLast->m_down = pSlab;
+			else
+				pFirst = pSlab;
+			pLast = pSlab;
 		}
-		delete [] a;
+		if(pFirst != nullptr)
+			pushSlabs(pe, pFirst, pLast, n);
 	}
+#endif
+}
 
-	leaveCS();
+
+PoolMemoryAllocator::SizeClassStatistics PoolMemoryAllocator::statistics(size_t nBytes)
+{
+	const PoolElement &pe = s_pool[nBytes];
+	SizeClassStatistics stat;
+	stat.m_blocks = pe.m_blocks;
+	stat.m_refills = pe.m_refills;
+	stat.m_flushes = pe.m_flushes;
+	return stat;
 }
 
 }
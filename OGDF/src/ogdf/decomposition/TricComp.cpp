@@ -123,17 +123,15 @@ TricComp::TricComp (const Graph& G) :
 	}
 #endif
 
-	m_A.init(GC);
-	m_IN_ADJ.init(GC,nullptr);
+	m_IN_ADJ.init(GC,-1);
 	buildAcceptableAdjStruct(GC);
 
 #ifdef TRIC_COMP_OUTPUT
 	cout << "\nadjaceny lists:" << endl;
 	for (node v : GC.nodes) {
 		cout << v << "\t";
-		for(edge ei : m_A[v]) {
-			printOs(ei);
-		}
+		for (int i = m_ADJ_first[v]; i < m_ADJ_last[v]; i++)
+			printOs(m_ADJ[i]);
 		cout << endl;
 	}
 #endif
@@ -145,9 +143,8 @@ TricComp::TricComp (const Graph& G) :
 	for (node v : GC.nodes) {
 		cout << GC.original(v) << ":  \t" << m_NEWNUM[v] << "   \t";
 		cout << m_LOWPT1[v] << "   \t" << m_LOWPT2[v] << "   \t";
-		ListConstIterator<int> itH;
-		for(int i : m_HIGHPT[v])
-			cout << i << " ";
+		for (int i = m_HIGH_first[v]; i >= 0; i = m_HIGH[i].m_next)
+			cout << m_HIGH[i].m_num << " ";
 		cout << endl;
 	}
 
@@ -186,8 +183,10 @@ TricComp::TricComp (const Graph& G) :
 	m_NUMBER.init(); m_LOWPT1.init();
 	m_LOWPT2.init(); m_FATHER.init();
 	m_ND    .init(); m_TYPE  .init();
-	m_A     .init(); m_NEWNUM.init();
-	m_HIGHPT.init(); m_START .init();
+	m_ADJ   .init(); m_NEWNUM.init();
+	m_ADJ_first.init(); m_ADJ_last.init();
+	m_HIGH  .init(); m_START .init();
+	m_HIGH_first.init(); m_HIGH_last.init();
 	m_DEGREE.init(); m_TREE_ARC.init();
 	m_IN_ADJ.init(); m_IN_HIGH.init();
 	m_NODEAT.init();
@@ -275,8 +274,7 @@ TricComp::TricComp(const Graph &G, bool &isTric, node &s1, node &s2)
 			GC.reverseEdge(e);
 	}
 
-	m_A.init(GC);
-	m_IN_ADJ.init(GC,nullptr);
+	m_IN_ADJ.init(GC,-1);
 	buildAcceptableAdjStruct(GC);
 
 	DFS2(GC);
@@ -300,8 +298,10 @@ TricComp::TricComp(const Graph &G, bool &isTric, node &s1, node &s2)
 	m_NUMBER.init(); m_LOWPT1.init();
 	m_LOWPT2.init(); m_FATHER.init();
 	m_ND    .init(); m_TYPE  .init();
-	m_A     .init(); m_NEWNUM.init();
-	m_HIGHPT.init(); m_START .init();
+	m_ADJ   .init(); m_NEWNUM.init();
+	m_ADJ_first.init(); m_ADJ_last.init();
+	m_HIGH  .init(); m_START .init();
+	m_HIGH_first.init(); m_HIGH_last.init();
 	m_DEGREE.init(); m_TREE_ARC.init();
 	m_IN_ADJ.init(); m_IN_HIGH.init();
 	m_NODEAT.init();
@@ -694,25 +694,51 @@ void TricComp::DFS1 (const Graph& G, node v, node u, node &s1)
 //           Construction of ordered adjaceny lists
 //----------------------------------------------------------
 
+// Two stable counting sorts, by phi and then by source, so that the
+// adjacency lists end up ordered by phi and stored one after another.
 void TricComp::buildAcceptableAdjStruct(const Graph& G)
 {
 	int max = 3*G.numberOfNodes()+2;
-	Array<List<edge> > BUCKET(1,max);
+	EdgeArray<int> phi(G);
+	Array<int> bucket(0,max+1,0); // bucket[i] is the first position of phi value i
+	int numAdj = 0;
 
 	for (edge e : G.edges) {
 		edgeType t = m_TYPE[e];
 		if (t == removed) continue;
 
 		node w = e->target();
-		int phi = (t == frond) ? 3*m_NUMBER[w]+1 : (
+		phi[e] = (t == frond) ? 3*m_NUMBER[w]+1 : (
 			(m_LOWPT2[w] < m_NUMBER[e->source()]) ? 3*m_LOWPT1[w] :
 			3*m_LOWPT1[w]+2);
-		BUCKET[phi].pushBack(e);
+		bucket[phi[e]+1]++;
+		numAdj++;
+	}
+	for (int i = 1; i <= max+1; i++)
+		bucket[i] += bucket[i-1];
+
+	Array<edge> sorted(numAdj);
+	for (edge e : G.edges) {
+		if (m_TYPE[e] != removed)
+			sorted[bucket[phi[e]]++] = e;
+	}
+
+	m_ADJ_first.init(G,0);
+	m_ADJ_last.init(G,0);
+	for (edge e : sorted)
+		m_ADJ_last[e->source()]++;
+	int pos = 0;
+	for (node v : G.nodes) {
+		m_ADJ_first[v] = pos;
+		pos += m_ADJ_last[v];
+		m_ADJ_last[v] = m_ADJ_first[v];
 	}
 
-	for (int i = 1; i <= max; i++) {
-		for (edge e : BUCKET[i])
-			m_IN_ADJ[e] = m_A[e->source()].pushBack(e);
+	m_ADJ.init(numAdj);
+	for (edge e : sorted) {
+		int &i = m_ADJ_last[e->source()];
+		m_IN_ADJ[e] = i;
+		m_ADJ[i++] = e;
 	}
 }
 
@@ -725,7 +751,8 @@ void TricComp::pathFinder(const Graph& G, node v)
 {
 	m_NEWNUM[v] = m_numCount - m_ND[v] + 1;
 
-	for(edge e : m_A[v]) {
+	for (int i = m_ADJ_first[v]; i < m_ADJ_last[v]; i++) {
+		edge e = m_ADJ[i];
 		node w = e->opposite(v);
 
 		if (m_newPath) {
@@ -738,7 +765,7 @@ void TricComp::pathFinder(const Graph& G, node v)
 			m_numCount--;
 
 		} else {
-			m_IN_HIGH[e] = m_HIGHPT[w].pushBack(m_NEWNUM[v]);
+			m_IN_HIGH[e] = HIGH_pushBack(w,m_NEWNUM[v]);
 			m_newPath = true;
 		}
 	}
@@ -747,8 +774,10 @@ void TricComp::pathFinder(const Graph& G, node v)
 void TricComp::DFS2 (const Graph& G)
 {
 	m_NEWNUM .init(G,0);
-	m_HIGHPT .init(G);
-	m_IN_HIGH.init(G,ListIterator<int>());
+	m_HIGH.clear();
+	m_HIGH_first.init(G,-1);
+	m_HIGH_last.init(G,-1);
+	m_IN_HIGH.init(G,-1);
 	m_START  .init(G,false);
 
 	m_numCount = G.numberOfNodes();
@@ -781,14 +810,14 @@ void TricComp::pathSearch (const Graph& G, node v)
 	int y, vnum = m_NEWNUM[v];
 	int a, b;
 
-	List<edge> &Adj = m_A[v];
-	int outv = Adj.size();
+	int outv = 0;
+	for (int it = m_ADJ_first[v]; it < m_ADJ_last[v]; it++)
+		if (m_ADJ[it] != nullptr) outv++;
 
-	ListIterator<edge> it, itNext;
-	for(it = Adj.begin(); it.valid(); it=itNext)
+	for (int it = m_ADJ_first[v]; it < m_ADJ_last[v]; it++)
 	{
-		itNext = it.succ();
-		e = *it;
+		e = m_ADJ[it];
+		if (e == nullptr) continue;
 		node w = e->target();
 		int wnum = m_NEWNUM[w];
 
@@ -815,7 +844,7 @@ void TricComp::pathSearch (const Graph& G, node v)
 			node x;
 
 			while (vnum != 1 && ((m_TSTACK_a[m_top] == vnum) ||
-				(m_DEGREE[w] == 2 && m_NEWNUM[m_A[w].front()->target()] > wnum)))
+				(m_DEGREE[w] == 2 && m_NEWNUM[firstAdj(w)->target()] > wnum)))
 			{
 				a = m_TSTACK_a[m_top];
 				b = m_TSTACK_b[m_top];
@@ -829,16 +858,16 @@ void TricComp::pathSearch (const Graph& G, node v)
 				else {
 					edge e_ab = nullptr;
 
-					if (m_DEGREE[w] == 2 && m_NEWNUM[m_A[w].front()->target()] > wnum) {
+					if (m_DEGREE[w] == 2 && m_NEWNUM[firstAdj(w)->target()] > wnum) {
 #ifdef TRIC_COMP_OUTPUT
 						cout << endl << "\nfound type-2 separation pair " <<
 							m_pGC->original(v) << ", " <<
-							m_pGC->original(m_A[w].front()->target());
+							m_pGC->original(firstAdj(w)->target());
 #endif
 
 						edge e1 = m_ESTACK.pop();
 						edge e2 = m_ESTACK.pop();
-						m_A[w].del(m_IN_ADJ[e2]);
+						delAdj(e2);
 
 						x = e2->target();
 
@@ -853,7 +882,7 @@ void TricComp::pathSearch (const Graph& G, node v)
 							e1 = m_ESTACK.top();
 							if (e1->source() == x && e1->target() == v) {
 								e_ab = m_ESTACK.pop();
-								m_A[x].del(m_IN_ADJ[e_ab]);
+								delAdj(e_ab);
 								delHigh(e_ab);
 							}
 						}
@@ -878,13 +907,13 @@ void TricComp::pathSearch (const Graph& G, node v)
 								(m_NEWNUM[y] == a && m_NEWNUM[x] == b))
 							{
 								e_ab = m_ESTACK.pop();
-								m_A[e_ab->source()].del(m_IN_ADJ[e_ab]);
+								delAdj(e_ab);
 								delHigh(e_ab);
 
 							} else {
 								edge eh = m_ESTACK.pop();
 								if (it != m_IN_ADJ[eh]) {
-									m_A[eh->source()].del(m_IN_ADJ[eh]);
+									delAdj(eh);
 									delHigh(eh);
 								}
 								C << eh;
@@ -908,7 +937,7 @@ void TricComp::pathSearch (const Graph& G, node v)
 					}
 
 					m_ESTACK.push(eVirt);
-					*it = eVirt;
+					m_ADJ[it] = eVirt;
 					m_IN_ADJ[eVirt] = it;
 
 					m_DEGREE[x]++; m_DEGREE[v]++;
@@ -951,7 +980,7 @@ void TricComp::pathSearch (const Graph& G, node v)
 					CompStruct &C = newComp(bond);
 					edge eh = m_ESTACK.pop();
 					if (m_IN_ADJ[eh] != it) {
-						m_A[eh->source()].del(m_IN_ADJ[eh]);
+						delAdj(eh);
 					}
 					C << eh << eVirt;
 					eVirt = m_pGC->newEdge(v,m_NODEAT[m_LOWPT1[w]]);
@@ -963,16 +992,16 @@ void TricComp::pathSearch (const Graph& G, node v)
 
 				if (m_NODEAT[m_LOWPT1[w]] != m_FATHER[v]) {
 					m_ESTACK.push(eVirt);
-					*it = eVirt;
+					m_ADJ[it] = eVirt;
 					m_IN_ADJ[eVirt] = it;
-					if (!m_IN_HIGH[eVirt].valid() && high(m_NODEAT[m_LOWPT1[w]]) < vnum)
-						m_IN_HIGH[eVirt] = m_HIGHPT[m_NODEAT[m_LOWPT1[w]]].pushFront(vnum);
+					if (m_IN_HIGH[eVirt] < 0 && high(m_NODEAT[m_LOWPT1[w]]) < vnum)
+						m_IN_HIGH[eVirt] = HIGH_pushFront(m_NODEAT[m_LOWPT1[w]],vnum);
 
 					m_DEGREE[v]++;
 					m_DEGREE[m_NODEAT[m_LOWPT1[w]]]++;
 
 				} else {
-					Adj.del(it);
+					m_ADJ[it] = nullptr;
 
 					CompStruct &C = newComp(bond);
 					C << eVirt;
@@ -987,7 +1016,7 @@ void TricComp::pathSearch (const Graph& G, node v)
 					m_TYPE[eVirt] = tree;
 
 					m_IN_ADJ[eVirt] = m_IN_ADJ[eh];
-					*m_IN_ADJ[eh] = eVirt;
+					m_ADJ[m_IN_ADJ[eh]] = eVirt;
 				}
 			}
 
@@ -1031,14 +1060,14 @@ bool TricComp::pathSearch (const Graph &G, node v, node &s1, node &s2)
 	int y, vnum = m_NEWNUM[v];
 	int a, b;
 
-	List<edge> &Adj = m_A[v];
-	int outv = Adj.size();
+	int outv = 0;
+	for (int it = m_ADJ_first[v]; it < m_ADJ_last[v]; it++)
+		if (m_ADJ[it] != nullptr) outv++;
 
-	ListIterator<edge> it, itNext;
-	for(it = Adj.begin(); it.valid(); it=itNext)
+	for (int it = m_ADJ_first[v]; it < m_ADJ_last[v]; it++)
 	{
-		itNext = it.succ();
-		e = *it;
+		e = m_ADJ[it];
+		if (e == nullptr) continue;
 		node w = e->target();
 		int wnum = m_NEWNUM[w];
 
@@ -1062,7 +1091,7 @@ bool TricComp::pathSearch (const Graph &G, node v, node &s1, node &s2)
 				return false;
 
 			while (vnum != 1 && ((m_TSTACK_a[m_top] == vnum) ||
-				(m_DEGREE[w] == 2 && m_NEWNUM[m_A[w].front()->target()] > wnum)))
+				(m_DEGREE[w] == 2 && m_NEWNUM[firstAdj(w)->target()] > wnum)))
 			{
 				a = m_TSTACK_a[m_top];
 				b = m_TSTACK_b[m_top];
@@ -1070,10 +1099,10 @@ bool TricComp::pathSearch (const Graph &G, node v, node &s1, node &s2)
 				if (a == vnum && m_FATHER[m_NODEAT[b]] == m_NODEAT[a]) {
 					m_top--;
 
-				} else if (m_DEGREE[w] == 2 && m_NEWNUM[m_A[w].front()->target()] > wnum)
+				} else if (m_DEGREE[w] == 2 && m_NEWNUM[firstAdj(w)->target()] > wnum)
 				{
 					s1 = v;
-					s2 = m_A[w].front()->target();
+					s2 = firstAdj(w)->target();
 					return false;
 
 				} else {
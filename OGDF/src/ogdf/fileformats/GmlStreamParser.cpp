@@ -0,0 +1,326 @@
+/** \file
+ * \brief Implementation of a single pass GML reader for MetaCarvel graphs.
+ *
+ * \author MetaCarvel developers
+ *
+ * \par License:
+ * This file is part of the Open Graph Drawing Framework (OGDF).
+ *
+ * \par
+ * Copyright (C)<br>
+ * See README.txt in the root directory of the OGDF installation for details.
+ *
+ * \par
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * Version 2 or 3 as published by the Free Software Foundation;
+ * see the file LICENSE.txt included in the packaging of this file
+ * for details.
+ *
+ * \par
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * \par
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free
+ * Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ *
+ * \see  http://www.gnu.org/copyleft/gpl.html
+ ***************************************************************/
+
+#include <ogdf/fileformats/GmlStreamParser.h>
+
+#include <cctype>
+#include <cstdlib>
+
+
+namespace ogdf {
+
+
+GmlStreamParser::GmlStreamParser(std::istream &is)
+	: m_is(is), m_pos(0), m_size(0), m_line(1), m_directed(false)
+{
+}
+
+
+void GmlStreamParser::error(const char *str)
+{
+	std::cerr << "ERROR: " << str << " at line " << m_line << ".\n";
+}
+
+
+// next character without consuming it, EOF at the end of the stream
+int GmlStreamParser::peekChar()
+{
+	if (m_pos == m_size) {
+		m_is.read(m_buffer, sizeof(m_buffer));
+		m_size = m_is.gcount();
+		m_pos = 0;
+		if (m_size == 0) return EOF;
+	}
+	return (unsigned char)m_buffer[m_pos];
+}
+
+
+GmlStreamParser::Token GmlStreamParser::nextToken()
+{
+	int c;
+	// white space and lines starting with '#'
+	for (;;) {
+		c = peekChar();
+		if (c == EOF) return tokEOF;
+		if (c == '\n') m_line++;
+		if (c == '#') {
+			while (c != EOF && c != '\n') {
+				m_pos++;
+				c = peekChar();
+			}
+			continue;
+		}
+		if (!isspace(c)) break;
+		m_pos++;
+	}
+
+	m_text.clear();
+	if (c == '[') { m_pos++; return tokListBegin; }
+	if (c == ']') { m_pos++; return tokListEnd; }
+
+	if (c == '"') {
+		m_pos++;
+		for (c = peekChar(); c != '"'; c = peekChar()) {
+			if (c == EOF) {
+				error("unterminated string");
+				return tokError;
+			}
+			if (c == '\n') m_line++;
+			m_text += char(c);
+			m_pos++;
+		}
+		m_pos++;
+		return tokString;
+	}
+
+	if (isdigit(c) || c == '-' || c == '+' || c == '.') {
+		while (c != EOF && (isalnum(c) || c == '-' || c == '+' || c == '.')) {
+			m_text += char(c);
+			m_pos++;
+			c = peekChar();
+		}
+		return tokNumber;
+	}
+
+	if (isalpha(c) || c == '_') {
+		while (c != EOF && (isalnum(c) || c == '_')) {
+			m_text += char(c);
+			m_pos++;
+			c = peekChar();
+		}
+		return tokKey;
+	}
+
+	error("unexpected character");
+	return tokError;
+}
+
+
+// reads the value following a key, skipping it if it is a list
+bool GmlStreamParser::readValue(Token &t)
+{
+	t = nextToken();
+	if (t == tokListBegin) return skipList();
+	if (t == tokNumber || t == tokString) return true;
+	error("expected value");
+	return false;
+}
+
+
+bool GmlStreamParser::skipList()
+{
+	for (int depth = 1; depth > 0; ) {
+		Token t = nextToken();
+		if (t == tokListBegin) depth++;
+		else if (t == tokListEnd) depth--;
+		else if (t == tokEOF) {
+			error("unexpected end of file in list");
+			return false;
+		}
+		else if (t == tokError) return false;
+	}
+	return true;
+}
+
+
+bool GmlStreamParser::read(Graph &G)
+{
+	G.clear();
+	m_idNode.clear();
+	m_pending.clear();
+	m_label.init(G);
+	m_nodeOrientation.init(G);
+	m_length.init(G, 0);
+	m_edgeOrientation.init(G);
+	m_mean.init(G, 0.0);
+	m_stdev.init(G, 0.0);
+	m_bsize.init(G, 1);
+
+	bool found = false;
+	for (;;) {
+		Token t = nextToken();
+		if (t == tokEOF) break;
+		if (t != tokKey) {
+			error("expected key");
+			return false;
+		}
+		if (m_text == "graph" && !found) {
+			if (nextToken() != tokListBegin) {
+				error("expected \"[\" after graph");
+				return false;
+			}
+			if (!readGraph(G)) return false;
+			found = true;
+		}
+		else if (!readValue(t)) return false;
+	}
+	if (!found) {
+		error("no graph");
+		return false;
+	}
+
+	// edges given before their nodes
+	for (const PendingEdge &p : m_pending) {
+		auto s = m_idNode.find(p.source), t = m_idNode.find(p.target);
+		if (s == m_idNode.end() || t == m_idNode.end()) {
+			error("edge to an undefined node");
+			return false;
+		}
+		newEdge(G, s->second, t->second, p);
+	}
+	m_pending.clear();
+	return true;
+}
+
+
+bool GmlStreamParser::readGraph(Graph &G)
+{
+	for (;;) {
+		Token t = nextToken();
+		if (t == tokListEnd) return true;
+		if (t != tokKey) {
+			if (t != tokError) error(t == tokEOF ? "unexpected end of file in graph" : "expected key");
+			return false;
+		}
+		if (m_text == "node" || m_text == "edge") {
+			bool isNode = m_text == "node";
+			if (nextToken() != tokListBegin) {
+				error("expected \"[\"");
+				return false;
+			}
+			if (!(isNode ? readNode(G) : readEdge(G))) return false;
+		}
+		else if (m_text == "directed") {
+			if (!readValue(t)) return false;
+			m_directed = atoi(m_text.c_str()) != 0;
+		}
+		else if (!readValue(t)) return false;
+	}
+}
+
+
+bool GmlStreamParser::readNode(Graph &G)
+{
+	bool hasId = false;
+	int id = 0, length = 0;
+	string label, orientation;
+	for (;;) {
+		Token t = nextToken();
+		if (t == tokListEnd) break;
+		if (t != tokKey) {
+			if (t != tokError) error(t == tokEOF ? "unexpected end of file in node" : "expected key");
+			return false;
+		}
+		string key = m_text;
+		if (!readValue(t)) return false;
+		if (t == tokListBegin) continue;
+		if (key == "id") {
+			id = atoi(m_text.c_str());
+			hasId = true;
+		}
+		else if (key == "label") label = m_text;
+		else if (key == "orientation") orientation = m_text;
+		else if (key == "length") length = atoi(m_text.c_str());
+	}
+	if (!hasId) {
+		error("node without id");
+		return false;
+	}
+	if (m_idNode.count(id)) {
+		error("duplicate node id");
+		return false;
+	}
+	node v = G.newNode();
+	m_idNode[id] = v;
+	m_label[v] = label;
+	m_nodeOrientation[v] = orientation;
+	m_length[v] = length;
+	return true;
+}
+
+
+bool GmlStreamParser::readEdge(Graph &G)
+{
+	bool hasSource = false, hasTarget = false;
+	PendingEdge p;
+	p.source = p.target = 0;
+	p.mean = p.stdev = 0.0;
+	p.bsize = 1;
+	for (;;) {
+		Token t = nextToken();
+		if (t == tokListEnd) break;
+		if (t != tokKey) {
+			if (t != tokError) error(t == tokEOF ? "unexpected end of file in edge" : "expected key");
+			return false;
+		}
+		string key = m_text;
+		if (!readValue(t)) return false;
+		if (t == tokListBegin) continue;
+		if (key == "source") {
+			p.source = atoi(m_text.c_str());
+			hasSource = true;
+		}
+		else if (key == "target") {
+			p.target = atoi(m_text.c_str());
+			hasTarget = true;
+		}
+		else if (key == "orientation") p.orientation = m_text;
+		else if (key == "mean") p.mean = atof(m_text.c_str());
+		else if (key == "stdev") p.stdev = atof(m_text.c_str());
+		else if (key == "bsize") p.bsize = atoi(m_text.c_str());
+	}
+	if (!hasSource || !hasTarget) {
+		error("edge without source or target");
+		return false;
+	}
+	auto s = m_idNode.find(p.source), t = m_idNode.find(p.target);
+	if (s == m_idNode.end() || t == m_idNode.end())
+		m_pending.push_back(p);
+	else
+		newEdge(G, s->second, t->second, p);
+	return true;
+}
+
+
+void GmlStreamParser::newEdge(Graph &G, node s, node t, const PendingEdge &attr)
+{
+	edge e = G.newEdge(s, t);
+	m_edgeOrientation[e] = attr.orientation;
+	m_mean[e] = attr.mean;
+	m_stdev[e] = attr.stdev;
+	m_bsize[e] = attr.bsize;
+}
+
+
+} // end namespace ogdf
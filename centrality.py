@@ -1,60 +1,80 @@
 import networkx as nx
 import argparse
 import numpy as np
-from multiprocessing.dummy import Pool as ThreadPool
-import multiprocessing
-
-parser = argparse.ArgumentParser()
-parser.add_argument("-g", "--graph", help='bundled graph')
-parser.add_argument("-l","--length",help="contig length")
-parser.add_argument("-o","--output",help="output file")
-args = parser.parse_args()
-G = nx.Graph()
-cpus = multiprocessing.cpu_count()
-with open(args.graph,'r') as f:
-    for line in f:
-        attrs = line.split()
-        G.add_edge(attrs[0],attrs[2],mean=float(attrs[4]),stdev=float(attrs[5]),bsize=int(attrs[6]),ori=attrs[1]+attrs[3])
-
-
-contig_length = {}
-with open(args.length,'r') as f:
-    for line in f:
-        attrs = line.split()
-        if attrs[0] in G.nodes():
-            contig_length[attrs[0]] = int(attrs[1])
-
-nx.set_node_attributes(G, contig_length, 'length')
-#print contig_length
-repeat_nodes = {}
+from multiprocessing import Pool
+from graphimage import GraphImage, is_image
+from compression import open_text
+from resources import available_cpus
 
 def get_centrality(subg):
     centralities = nx.betweenness_centrality(subg)
     mean = np.mean(list(centralities.values()))
     stdev = np.std(list(centralities.values()))
-    for node in centralities:
-        if centralities[node] >= mean + 3*stdev:
-            repeat_nodes[node] = centralities[node]
+    return [(node, centralities[node]) for node in centralities if centralities[node] >= mean + 3*stdev]
+
+def centrality_wrapper(graph, cpus, repeat_nodes):
+    # betweenness is pure Python, so the components are spread over processes rather than threads.
+    # Results are merged in component order, as a serial run would find them.
+    components = [graph.subgraph(c).copy() for c in nx.connected_components(graph) if len(c) >= 50]
+    if cpus == 1 or len(components) <= 1:
+        results = [get_centrality(subg) for subg in components]
+    else:
+        pool = Pool(min(cpus, len(components)))
+        results = pool.map(get_centrality, components)
+        pool.close()
+        pool.join()
+    for result in results:
+        for node, centrality in result:
+            repeat_nodes[node] = centrality
+
+def main():
+    # the pool workers only run get_centrality, under spawn and forkserver they import this module
+    # without running main again
+    parser = argparse.ArgumentParser()
+    parser.add_argument("-g", "--graph", help='bundled graph')
+    parser.add_argument("-l","--length",help="contig length")
+    parser.add_argument("-o","--output",help="output file")
+    parser.add_argument("-t","--threads",help="number of processes, all CPUs available to the process by default",type=int,default=available_cpus())
+    args = parser.parse_args()
+    G = nx.Graph()
+    cpus = max(1, args.threads)
+    if is_image(args.graph):
+        #graph image from bundler, edges come straight from its link arrays
+        image = GraphImage(args.graph)
+        names = image.names()
+        contig_a, contig_b = image.array('contig_a'), image.array('contig_b')
+        end_a, end_b = image.array('end_a'), image.array('end_b')
+        mean, stdev, bsize = image.array('mean'), image.array('stdev'), image.array('bsize')
+        for l in range(image.nlinks):
+            G.add_edge(names[contig_a[l]],names[contig_b[l]],mean=mean[l],stdev=stdev[l],bsize=bsize[l],ori=chr(end_a[l])+chr(end_b[l]))
+    else:
+        with open_text(args.graph) as f:
+            for line in f:
+                attrs = line.split()
+                G.add_edge(attrs[0],attrs[2],mean=float(attrs[4]),stdev=float(attrs[5]),bsize=int(attrs[6]),ori=attrs[1]+attrs[3])
+
+
+    contig_length = {}
+    with open_text(args.length) as f:
+        for line in f:
+            attrs = line.split()
+            if attrs[0] in G.nodes():
+                contig_length[attrs[0]] = int(attrs[1])
+
+    nx.set_node_attributes(G, contig_length, 'length')
+    #print contig_length
+    repeat_nodes = {}
 
-def centrality_wrapper(graph):
-    pool =  ThreadPool(cpus)
-    for subg in nx.connected_components(graph):
-        #get_centrality(subg)
-        subg = graph.subgraph(subg) 
-        if len(subg.nodes()) >= 50:
-            result = pool.map(get_centrality,[subg])
-    pool.close()
-    pool.join()
-G_copy = G.copy()
+    G_copy = G.copy()
 
-ofile = open(args.output,'w')
+    ofile = open(args.output,'w')
 
-for i in range(3):
-    centrality_wrapper(G_copy)
-    for node in repeat_nodes:
-        if G_copy.has_node(node):
-            G_copy.remove_node(node)
-        ofile.write(str(node)+'\t'+str(repeat_nodes[node])+'\n')
+    for i in range(3):
+        centrality_wrapper(G_copy, cpus, repeat_nodes)
+        for node in repeat_nodes:
+            if G_copy.has_node(node):
+                G_copy.remove_node(node)
+            ofile.write(str(node)+'\t'+str(repeat_nodes[node])+'\n')
 
 
  
@@ -62,3 +82,5 @@ for i in range(3):
 #    print u +"\t"+data[u][v]['ori'][0]+v+"\t"+data[u][v]['ori'][1]+"\t"+str(data[u][v]["mean"])+"\t"+str(data[u][v]["stdev"])+"\t"+str(data[u][v]["bsize"])
 #nx.write_gml(G_copy,args.output)
 
+if __name__ == '__main__':
+    main()
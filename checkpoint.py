@@ -0,0 +1,78 @@
+import hashlib
+import json
+import os
+
+'''
+Checkpoint manifest for resumable runs.
+
+For every stage the manifest (checkpoint.json in the output directory) records the content
+hashes of the files it read and wrote and the parameters it ran with. A stage is up to date when
+its parameters are the same, its inputs hash to the recorded values and its outputs are still
+there unchanged. Since a rerun stage changes the hashes of its outputs, everything downstream of
+it is recomputed as well.
+
+Hashes are cached in the manifest by file size and modification time, so unchanged files (the
+BAM file in particular) are not read again on every run.
+'''
+class Checkpoint:
+    def __init__(self, dir):
+        self.path = os.path.join(dir, 'checkpoint.json')
+        self.stages = {}
+        self.files = {}
+        if os.path.exists(self.path):
+            try:
+                with open(self.path, 'r') as f:
+                    manifest = json.load(f)
+                self.stages = manifest.get('stages', {})
+                self.files = manifest.get('files', {})
+            except ValueError:
+                # a manifest cut short by a killed run, start over
+                self.stages = {}
+                self.files = {}
+
+    def file_hash(self, path):
+        path = os.path.abspath(path)
+        if not os.path.exists(path):
+            return None
+        st = os.stat(path)
+        cached = self.files.get(path)
+        if cached is not None and cached['size'] == st.st_size and cached['mtime'] == st.st_mtime:
+            return cached['sha1']
+        h = hashlib.sha1()
+        with open(path, 'rb') as f:
+            for block in iter(lambda: f.read(1 << 20), b''):
+                h.update(block)
+        self.files[path] = {'size': st.st_size, 'mtime': st.st_mtime, 'sha1': h.hexdigest()}
+        return h.hexdigest()
+
+    def hashes(self, paths):
+        return dict((os.path.abspath(p), self.file_hash(p)) for p in paths)
+
+    def is_current(self, stage, inputs, outputs, params):
+        entry = self.stages.get(stage)
+        if entry is None:
+            return False
+        if entry['params'] != dict((k, str(v)) for k, v in params.items()):
+            return False
+        for recorded, paths in ((entry['inputs'], inputs), (entry['outputs'], outputs)):
+            current = self.hashes(paths)
+            if None in current.values() or current != recorded:
+                return False
+        return True
+
+    def record(self, stage, inputs, outputs, params):
+        self.stages[stage] = {'inputs': self.hashes(inputs),
+                              'outputs': self.hashes(outputs),
+                              'params': dict((k, str(v)) for k, v in params.items())}
+        self.save()
+
+    def invalidate(self, stage):
+        if stage in self.stages:
+            del self.stages[stage]
+            self.save()
+
+    def save(self):
+        tmp = self.path + '.tmp'
+        with open(tmp, 'w') as f:
+            json.dump({'stages': self.stages, 'files': self.files}, f, indent=1, sort_keys=True)
+        os.rename(tmp, self.path)
@@ -0,0 +1,61 @@
+import gzip
+import io
+import shutil
+import subprocess
+
+'''
+Transparently compressed text files, the Python side of core/compress.h. gzip and zstd inputs are
+recognised by their magic bytes, outputs named *.gz or *.zst are compressed. zstd goes through the
+zstd command, so no extra module is needed.
+'''
+
+def file_compression(path):
+    with open(path, 'rb') as f:
+        header = f.read(4)
+    if header == b'\x28\xb5\x2f\xfd':
+        return 'zst'
+    if header[:2] == b'\x1f\x8b':
+        return 'gz'
+    return None
+
+class Pipe(io.TextIOWrapper):
+    # text stream over a (de)compressor process, waited for on close
+    def __init__(self, process, stream):
+        io.TextIOWrapper.__init__(self, stream)
+        self.process = process
+
+    def close(self):
+        if self.closed:
+            return
+        io.TextIOWrapper.close(self)
+        if self.process.wait() != 0:
+            raise IOError(' '.join(self.process.args)+' failed')
+
+def open_text(path, mode='r'):
+    # open() for text files that may be compressed
+    if 'w' in mode:
+        if path.endswith('.gz'):
+            return gzip.open(path, 'wt')
+        if path.endswith('.zst'):
+            out = open(path, 'wb')
+            p = subprocess.Popen(['zstd', '-q', '-c'], stdin=subprocess.PIPE, stdout=out)
+            out.close()
+            return Pipe(p, p.stdin)
+        return open(path, mode)
+    kind = file_compression(path)
+    if kind == 'gz':
+        return gzip.open(path, 'rt')
+    if kind == 'zst':
+        p = subprocess.Popen(['zstd', '-dcq', path], stdout=subprocess.PIPE)
+        return Pipe(p, p.stdout)
+    return open(path, mode)
+
+def compressor(kind, threads):
+    # shell command compressing stdin to stdout, preferring parallel and BGZF writing tools
+    if kind == 'zst':
+        return 'zstd -q -T'+str(threads)+' -c'
+    if shutil.which('bgzip'):
+        return 'bgzip -@ '+str(threads)+' -c'
+    if shutil.which('pigz'):
+        return 'pigz -p '+str(threads)+' -c'
+    return 'gzip -c'
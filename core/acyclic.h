@@ -0,0 +1,285 @@
+#ifndef METACARVEL_ACYCLIC_H
+#define METACARVEL_ACYCLIC_H
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "contigs.h"
+#include "links.h"
+#include "orient.h"
+#include "resources.h"
+
+//Cycle removal on the oriented graph (orientcontigs --acyclic). Cycles left after orientation
+//keep layout from tracing scaffolds through them, so a feedback arc set of small total bundle
+//size is invalidated as well, leaving every component a DAG. Only links inside a strongly
+//connected component can close a cycle, and each such component is handled on its own, the
+//components in parallel.
+//
+//Within a component the contigs are put in a line by the greedy heuristic of Eades, Lin and
+//Smyth, the one OGDF's GreedyCycleRemoval implements, weighted by bundle size: sinks go to the
+//right end, sources to the left end, and otherwise the contig whose outgoing bundles outweigh
+//its incoming ones the most goes left. Links pointing backwards in the line form the feedback
+//arc set. They are then put back, heaviest first, whenever that does not close a cycle.
+
+//feedback arcs among the links arcs inside the component of contigs nodes, marked in removed
+inline void component_feedback_arcs(const LinkArray &links, const std::vector<int> &nodes, const std::vector<int> &arcs, std::vector<char> &removed)
+{
+    int n = nodes.size();
+    std::unordered_map<int,int> local;
+    for(int u = 0; u < n; u++)
+        local[nodes[u]] = u;
+    std::vector<int> source(arcs.size()), target(arcs.size());
+    std::vector<std::vector<int> > out(n), in(n);
+    std::vector<long long> delta(n, 0);
+    std::vector<int> outdeg(n, 0), indeg(n, 0);
+    for(int i = 0; i < int(arcs.size()); i++)
+    {
+        const Link &l = links[arcs[i]];
+        source[i] = local[l.contig_a];
+        target[i] = local[l.contig_b];
+        out[source[i]].push_back(i);
+        in[target[i]].push_back(i);
+        outdeg[source[i]]++;
+        indeg[target[i]]++;
+        delta[source[i]] += l.bundle_size;
+        delta[target[i]] -= l.bundle_size;
+    }
+
+    std::vector<bool> alive(n, true);
+    std::vector<int> left, right, sources, sinks;
+    std::priority_queue<std::pair<long long,int> > heap;     //delta and -contig, ties to the first
+    for(int u = 0; u < n; u++)
+        heap.push(std::make_pair(delta[u], -u));
+    for(int remaining = n; remaining > 0; remaining--)
+    {
+        int u = -1;
+        while(u == -1 && !sinks.empty())
+        {
+            u = alive[sinks.back()] ? sinks.back() : -1;
+            sinks.pop_back();
+        }
+        if(u != -1)
+        {
+            right.push_back(u);
+        }
+        else
+        {
+            while(u == -1 && !sources.empty())
+            {
+                u = alive[sources.back()] ? sources.back() : -1;
+                sources.pop_back();
+            }
+            while(u == -1)
+            {
+                std::pair<long long,int> top = heap.top();
+                heap.pop();
+                if(alive[-top.second] && delta[-top.second] == top.first)
+                    u = -top.second;
+            }
+            left.push_back(u);
+        }
+        alive[u] = false;
+        for(int j = 0; j < int(out[u].size()); j++)
+        {
+            int i = out[u][j], w = target[i];
+            if(!alive[w])
+                continue;
+            delta[w] += links[arcs[i]].bundle_size;
+            heap.push(std::make_pair(delta[w], -w));
+            if(--indeg[w] == 0)
+                sources.push_back(w);
+        }
+        for(int j = 0; j < int(in[u].size()); j++)
+        {
+            int i = in[u][j], w = source[i];
+            if(!alive[w])
+                continue;
+            delta[w] -= links[arcs[i]].bundle_size;
+            heap.push(std::make_pair(delta[w], -w));
+            if(--outdeg[w] == 0)
+                sinks.push_back(w);
+        }
+    }
+    std::vector<int> position(n);
+    for(int k = 0; k < int(left.size()); k++)
+        position[left[k]] = k;
+    for(int k = 0; k < int(right.size()); k++)
+        position[right[k]] = n - 1 - k;
+
+    //forward links are kept, backward ones put back heaviest first unless they close a cycle.
+    //position stays a topological order of the kept links, so the search for a cycle only goes
+    //through the contigs between the two ends of a link. Putting a link back moves the contigs its
+    //target reaches behind the contigs reaching its source, by shifting the positions in between
+    //(Marchetti-Spaccamela, Nanni and Rohnert) or, when few contigs are involved, by permuting only
+    //their positions (Pearce and Kelly).
+    std::vector<std::vector<int> > kept(n), kept_in(n);
+    std::vector<int> backward;
+    for(int i = 0; i < int(arcs.size()); i++)
+    {
+        if(position[source[i]] < position[target[i]])
+        {
+            kept[source[i]].push_back(target[i]);
+            kept_in[target[i]].push_back(source[i]);
+        }
+        else
+        {
+            backward.push_back(i);
+        }
+    }
+    std::stable_sort(backward.begin(), backward.end(), [&](int a, int b) { return links[arcs[a]].bundle_size > links[arcs[b]].bundle_size; });
+    std::vector<int> at(n);
+    for(int u = 0; u < n; u++)
+        at[position[u]] = u;
+    std::vector<int> seen(n, -1), ahead(n, -1), stack, reached, reaching, slots;
+    for(int k = 0; k < int(backward.size()); k++)
+    {
+        int i = backward[k], s = source[i], t = target[i];
+        int lower = position[t], upper = position[s];
+        //does the target already reach the source?
+        bool cycle = s == t;
+        reached.clear();
+        if(!cycle && lower < upper)
+        {
+            stack.assign(1, t);
+            seen[t] = k;
+            while(!cycle && !stack.empty())
+            {
+                int u = stack.back();
+                stack.pop_back();
+                reached.push_back(u);
+                for(int j = 0; j < int(kept[u].size()) && !cycle; j++)
+                {
+                    int w = kept[u][j];
+                    cycle = w == s;
+                    if(seen[w] != k && position[w] < upper)
+                    {
+                        seen[w] = k;
+                        stack.push_back(w);
+                    }
+                }
+            }
+        }
+        if(cycle)
+        {
+            removed[arcs[i]] = 1;
+            continue;
+        }
+        kept[s].push_back(t);
+        kept_in[t].push_back(s);
+        if(lower > upper)
+            continue;
+        //contigs reaching the source from the target's position on, given up on once there are
+        //so many that shifting all positions in between is cheaper
+        int range = upper - lower;
+        bool shift = range <= 4 * int(reached.size());
+        reaching.clear();
+        stack.assign(shift ? 0 : 1, s);
+        ahead[s] = k;
+        while(!stack.empty() && !shift)
+        {
+            int u = stack.back();
+            stack.pop_back();
+            reaching.push_back(u);
+            shift = range <= 4 * int(reached.size() + reaching.size());
+            for(int j = 0; j < int(kept_in[u].size()); j++)
+            {
+                int w = kept_in[u][j];
+                if(ahead[w] != k && position[w] > lower)
+                {
+                    ahead[w] = k;
+                    stack.push_back(w);
+                }
+            }
+        }
+        if(shift)
+        {
+            //the contigs in between that are not reached keep their order ahead of the reached ones
+            int next = lower, nreached = 0;
+            for(int p = lower; p <= upper; p++)
+            {
+                int u = at[p];
+                if(seen[u] == k)
+                    reached[nreached++] = u;
+                else
+                    at[next++] = u;
+            }
+            for(int j = 0; j < nreached; j++)
+                at[next++] = reached[j];
+            for(int p = lower; p <= upper; p++)
+                position[at[p]] = p;
+            continue;
+        }
+        //the contigs reaching the source take the first of their joint positions, the reached ones the rest
+        auto by_position = [&](int a, int b) { return position[a] < position[b]; };
+        std::sort(reached.begin(), reached.end(), by_position);
+        std::sort(reaching.begin(), reaching.end(), by_position);
+        slots.clear();
+        for(int j = 0; j < int(reaching.size()); j++)
+            slots.push_back(position[reaching[j]]);
+        for(int j = 0; j < int(reached.size()); j++)
+            slots.push_back(position[reached[j]]);
+        std::sort(slots.begin(), slots.end());
+        reaching.insert(reaching.end(), reached.begin(), reached.end());
+        for(int j = 0; j < int(reaching.size()); j++)
+        {
+            position[reaching[j]] = slots[j];
+            at[slots[j]] = reaching[j];
+        }
+    }
+}
+
+//Invalidates a feedback arc set of the valid links of result, leaving the oriented graph acyclic.
+//The counts of invalidated links per contig are left as they are, they describe the orientation.
+inline void remove_cycles(const LinkArray &links, const ContigTable &contigs, Orientation &result)
+{
+    ScopedTimer timer("remove cycles");
+    std::vector<int> valid;
+    LinkArray graph_links;
+    for(int i = 0; i < int(links.size()); i++)
+    {
+        if(result.invalid[i])
+            continue;
+        valid.push_back(i);
+        graph_links.push_back(links[i]);
+    }
+    LinkGraph graph(contigs.size(), graph_links);
+    std::vector<int> postorder;
+    std::vector<int> component = strong_components(graph_links, graph, contigs.by_name(), postorder);
+
+    //contigs and links of every component of more than one contig
+    int ncomponents = 0;
+    for(int i = 0; i < int(postorder.size()); i++)
+        ncomponents = std::max(ncomponents, component[postorder[i]] + 1);
+    std::vector<std::vector<int> > nodes(ncomponents), arcs(ncomponents);
+    for(int i = int(postorder.size()) - 1; i >= 0; i--)
+        nodes[component[postorder[i]]].push_back(postorder[i]);
+    for(int i = 0; i < int(graph_links.size()); i++)
+        if(component[graph_links[i].contig_a] == component[graph_links[i].contig_b])
+            arcs[component[graph_links[i].contig_a]].push_back(i);
+    std::vector<int> cyclic;
+    for(int c = 0; c < ncomponents; c++)
+        if(nodes[c].size() > 1)
+            cyclic.push_back(c);
+
+    std::vector<char> removed(graph_links.size(), 0);
+    parallel_for(cyclic.size(), [&](int k) {
+        component_feedback_arcs(graph_links, nodes[cyclic[k]], arcs[cyclic[k]], removed);
+    });
+    long long count = 0, weight = 0;
+    for(int i = 0; i < int(graph_links.size()); i++)
+    {
+        if(!removed[i])
+            continue;
+        result.invalid[valid[i]] = true;
+        count++;
+        weight += graph_links[i].bundle_size;
+    }
+    Stats::get().count("cyclic components", cyclic.size());
+    Stats::get().count("feedback links", count);
+    Stats::get().count("feedback bundle size", weight);
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef METACARVEL_BLOOM_H
+#define METACARVEL_BLOOM_H
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+//Counting Bloom filter that only needs to tell keys seen once from keys seen at least twice. Each
+//key maps to HASHES two bit counters that saturate at 2, and a key counts as seen twice when all
+//of them do. Keys seen twice are always reported as such, keys seen once only with the false
+//positive rate of the filter.
+class CountingBloom
+{
+public:
+    static const int HASHES = 4;
+    static const int COUNTERS_PER_KEY = 8;
+    explicit CountingBloom(long long keys);
+    void add(const std::string &key);
+    bool seen_twice(const std::string &key) const;
+    unsigned long long bytes() const { return words.size() * sizeof(unsigned long long); }
+private:
+    void slots(const std::string &key, unsigned long long *slot) const;
+    int get(unsigned long long slot) const { return (words[slot >> 5] >> ((slot & 31) * 2)) & 3; }
+    std::vector<unsigned long long> words;  //32 counters each
+    unsigned long long ncounters;
+};
+
+inline CountingBloom :: CountingBloom(long long keys)
+{
+    ncounters = std::max(1LL, keys) * COUNTERS_PER_KEY;
+    words.assign((ncounters + 31) / 32, 0);
+    ncounters = words.size() * 32;
+}
+
+//double hashing from std::hash and a 64 bit finaliser of it
+inline void CountingBloom :: slots(const std::string &key, unsigned long long *slot) const
+{
+    unsigned long long h1 = std::hash<std::string>()(key);
+    unsigned long long h2 = h1 ^ (h1 >> 33);
+    h2 *= 0xff51afd7ed558ccdULL;
+    h2 ^= h2 >> 33;
+    h2 *= 0xc4ceb9fe1a85ec53ULL;
+    h2 ^= h2 >> 33;
+    h2 |= 1;
+    for(int i = 0; i < HASHES; i++)
+        slot[i] = (h1 + i * h2) % ncounters;
+}
+
+inline void CountingBloom :: add(const std::string &key)
+{
+    unsigned long long slot[HASHES];
+    slots(key, slot);
+    for(int i = 0; i < HASHES; i++)
+    {
+        int c = get(slot[i]);
+        if(c < 2)
+            words[slot[i] >> 5] += 1ULL << ((slot[i] & 31) * 2);
+    }
+}
+
+inline bool CountingBloom :: seen_twice(const std::string &key) const
+{
+    unsigned long long slot[HASHES];
+    slots(key, slot);
+    for(int i = 0; i < HASHES; i++)
+        if(get(slot[i]) < 2)
+            return false;
+    return true;
+}
+
+#endif
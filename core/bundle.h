@@ -0,0 +1,296 @@
+#ifndef METACARVEL_BUNDLE_H
+#define METACARVEL_BUNDLE_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "contigs.h"
+#include "links.h"
+#include "resources.h"
+
+//Bundling of read pair links between the same pair of contig ends (bundler).
+
+inline bool pairCompare(const std::pair<int, int>& firstElem, const std::pair<int, int>& secondElem) {
+  return firstElem.second < secondElem.second;
+}
+
+//Links grouped by contig pair and orientation. Groups are ordered the way bundler always
+//visited them: by "contig_a$contig_b" and then by orientation, each holding its links in input order.
+inline std::vector<std::vector<int> > group_links(const LinkArray &links, const ContigTable &contigs)
+{
+    ScopedTimer timer("group");
+    std::vector<std::vector<int> > groups;
+    std::unordered_map<LinkKey, int, LinkKey::Hash> group_of;
+    for(int i = 0; i < int(links.size()); i++)
+    {
+        LinkKey key(links[i]);
+        std::unordered_map<LinkKey, int, LinkKey::Hash> :: iterator it = group_of.find(key);
+        if(it == group_of.end())
+        {
+            group_of.insert(std::make_pair(key, int(groups.size())));
+            groups.push_back(std::vector<int>(1, i));
+        }
+        else
+        {
+            groups[it->second].push_back(i);
+        }
+    }
+
+    std::vector<std::pair<std::string, int> > keys(groups.size());
+    for(int i = 0; i < int(groups.size()); i++)
+    {
+        const Link &l = links[groups[i][0]];
+        keys[i] = std::make_pair(contigs.name(l.contig_a) + "$" + contigs.name(l.contig_b) + '\0' + l.orientation(), i);
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<std::vector<int> > ordered(groups.size());
+    for(int i = 0; i < int(keys.size()); i++)
+        ordered[i].swap(groups[keys[i].second]);
+    Stats::get().count("groups", ordered.size());
+    return ordered;
+}
+
+//The links of a clique compressed to a single link, their means combined by inverse variance.
+//Links standing for several read pairs count, and weigh in the mean, that many times.
+inline void merge_clique(const LinkArray &links, const std::vector<int> &clique_links, Link &newlink)
+{
+    double p = 0,q = 0;
+    int pairs = 0;
+    for(int i = 0;i < int(clique_links.size());i++)
+    {
+        double tmp = links[clique_links[i]].stdev;
+        if(tmp == 0)
+            tmp = 1;
+        tmp  = tmp*tmp;
+        double weight = links[clique_links[i]].bundle_size;
+        p += weight*links[clique_links[i]].mean*1.0/tmp;
+        q += weight/tmp;
+        pairs += links[clique_links[i]].bundle_size;
+    }
+    newlink = links[clique_links[0]];
+    newlink.mean = p/q;
+    newlink.stdev = 1/sqrt(q);
+    newlink.bundle_size = pairs;
+}
+
+//Maximal clique of the mean +- 3 stdev intervals of one group, compressed to a single link.
+//Returns false if no clique was found.
+inline bool bundle_group(const LinkArray &links, const std::vector<int> &group, Link &newlink)
+{
+    std::vector< std::pair<int,double> > begins;
+    std::vector< std::pair<int,double> > ends;
+
+    for(int i = 0;i < int(group.size());i++)
+    {
+        const Link &link = links[group[i]];
+        begins.push_back(std::make_pair(group[i], link.mean - 3*link.stdev));
+        ends.push_back(std::make_pair(group[i], link.mean + 3*link.stdev));
+    }
+
+    //sort begins and ends in increasing order
+    std::sort(begins.begin(),begins.end(),pairCompare);
+    std::sort(ends.begin(),ends.end(),pairCompare);
+    int start_index = 0;
+    int end_index = 0;
+    int nbegins = begins.size(), nends = ends.size();
+    int curr_clique = 0, best_clique = 0;
+    double best_coord = -100000;
+    std::vector<int> clique_links;
+    while(start_index < nbegins && end_index < nends)
+    {
+        if(start_index < nbegins - 1 && begins[start_index].second <= ends[end_index].second)
+        {
+            const Link &curlink = links[begins[start_index].first];
+            double begin_left = curlink.mean - 3*curlink.stdev;
+            curr_clique++;
+            if (curr_clique > best_clique)
+            {
+                best_clique = curr_clique;
+                clique_links.clear();
+                best_coord = begin_left;
+            }
+            start_index++;
+        }
+        else
+        {
+            if((end_index < nends) && ((start_index == nbegins - 1 || (begins[start_index].second > ends[end_index].second))))
+            {
+                const Link &curlink = links[ends[end_index].first];
+                double end_left = curlink.mean - 3*curlink.stdev;
+                double end_right = curlink.mean + 3*curlink.stdev;
+
+                if(end_left <= best_coord && end_right >= best_coord)
+                {
+                    clique_links.push_back(ends[end_index].first);
+                }
+                curr_clique--;
+                end_index++;
+            }
+        }
+    }
+    if(clique_links.size() == 0)
+        return false;
+    merge_clique(links, clique_links, newlink);
+    return true;
+}
+
+//Approximate bundle_group in linear time for very large groups. The interval ends are binned into
+//a histogram of bin_width wide bins, the deepest bin is found by a prefix sum over the interval
+//counts and the links whose intervals reach into it are bundled. Every one of them is within
+//bin_width of overlapping all the others, and there are at least as many as in the maximal clique,
+//which lies within a single point. The bins are widened if the intervals span more than max_bins.
+inline bool bundle_group_binned(const LinkArray &links, const std::vector<int> &group, double bin_width, Link &newlink)
+{
+    const long long max_bins = 1 << 20;
+    double lo = links[group[0]].mean - 3*links[group[0]].stdev, hi = lo;
+    for(int i = 0; i < int(group.size()); i++)
+    {
+        const Link &link = links[group[i]];
+        lo = std::min(lo, link.mean - 3*link.stdev);
+        hi = std::max(hi, link.mean + 3*link.stdev);
+    }
+    if(bin_width <= 0 || (hi - lo) / bin_width >= max_bins)
+        bin_width = (hi - lo) / (max_bins - 1);
+    long long nbins = (bin_width > 0) ? (long long)((hi - lo) / bin_width) + 1 : 1;
+
+    //interval starts minus interval ends per bin, summed up to the depth of each bin
+    std::vector<int> first_bin(group.size()), last_bin(group.size());
+    std::vector<int> depth(nbins + 1, 0);
+    for(int i = 0; i < int(group.size()); i++)
+    {
+        const Link &link = links[group[i]];
+        first_bin[i] = (bin_width > 0) ? std::min(nbins - 1, (long long)((link.mean - 3*link.stdev - lo) / bin_width)) : 0;
+        last_bin[i] = (bin_width > 0) ? std::min(nbins - 1, (long long)((link.mean + 3*link.stdev - lo) / bin_width)) : 0;
+        depth[first_bin[i]]++;
+        depth[last_bin[i] + 1]--;
+    }
+    int best = 0;
+    for(int b = 1; b < nbins; b++)
+    {
+        depth[b] += depth[b-1];
+        if(depth[b] > depth[best])
+            best = b;
+    }
+
+    std::vector<int> clique_links;
+    for(int i = 0; i < int(group.size()); i++)
+        if(first_bin[i] <= best && best <= last_bin[i])
+            clique_links.push_back(group[i]);
+    if(clique_links.size() == 0)
+        return false;
+    merge_clique(links, clique_links, newlink);
+    return true;
+}
+
+//read pairs behind the links of a group
+inline long long group_pairs(const LinkArray &links, const std::vector<int> &group)
+{
+    long long pairs = 0;
+    for(int i = 0; i < int(group.size()); i++)
+        pairs += links[group[i]].bundle_size;
+    return pairs;
+}
+
+//For each pair of contig, for each possible orientation apply maximal clique algorithm and compress links to 1.
+//Groups not larger than cutoff are represented by their first link with bundle size 1. Groups are
+//swept in parallel (Resources::threads), the bundles still come out in group order. With
+//binned_size > 0, groups of more links than that are bundled on a histogram (bundle_group_binned).
+inline LinkArray bundle_links(const LinkArray &links, const ContigTable &contigs, int cutoff, int binned_size = 0, double bin_width = 10)
+{
+    std::vector<std::vector<int> > groups = group_links(links, contigs);
+    ScopedTimer timer("sweep");
+    int ngroups = groups.size();
+    LinkArray bundles(ngroups);
+    std::vector<char> found(ngroups, 0);
+    parallel_for(ngroups, [&](int i) {
+        const std::vector<int> &group = groups[i];
+        //Apply clique algorithm only if number of link with same orientation is more than cutoff
+        if(group_pairs(links, group) > cutoff)
+        {
+            if(binned_size > 0 && int(group.size()) > binned_size)
+                found[i] = bundle_group_binned(links, group, bin_width, bundles[i]);
+            else
+                found[i] = bundle_group(links, group, bundles[i]);
+        }
+        else
+        {
+            bundles[i] = links[group[0]];
+            bundles[i].bundle_size = 1;
+            found[i] = true;
+        }
+    });
+    LinkArray bundled_links;
+    long long swept = 0, binned = 0;
+    for(int i = 0; i < ngroups; i++)
+    {
+        if(group_pairs(links, groups[i]) > cutoff)
+            swept++;
+        if(group_pairs(links, groups[i]) > cutoff && binned_size > 0 && int(groups[i].size()) > binned_size)
+            binned++;
+        if(found[i])
+            bundled_links.push_back(bundles[i]);
+    }
+    Stats::get().count("swept groups", swept);
+    if(binned_size > 0)
+        Stats::get().count("binned groups", binned);
+    return bundled_links;
+}
+
+inline LinkArray supported_links(const LinkArray &bundled_links, int cutoff)
+{
+    LinkArray ret;
+    for(int i = 0; i < int(bundled_links.size()); i++)
+        if(bundled_links[i].bundle_size >= cutoff)
+            ret.push_back(bundled_links[i]);
+    return ret;
+}
+
+inline void write_bundled_graph(std::ostream &g, const ContigTable &contigs, const LinkArray &bundled_links, int cutoff)
+{
+    ScopedTimer timer("write bundled graph");
+    int nodeid = 1;
+    std::vector<int> contig2node(contigs.size(), 0);
+    for(int i = 0;i < int(bundled_links.size());i++)
+    {
+        const Link &l = bundled_links[i];
+        if(contig2node[l.contig_a] == 0)
+            contig2node[l.contig_a] = nodeid++;
+        if(contig2node[l.contig_b] == 0)
+            contig2node[l.contig_b] = nodeid++;
+    }
+
+    g <<"graph ["<<"\n";
+    g <<" directed 1"<<"\n";
+    std::vector<int> order = contigs.by_name();
+    for(int i = 0; i < int(order.size()); i++)
+    {
+        if(contig2node[order[i]] == 0)
+            continue;
+        g<<" node ["<<"\n";
+        g<<"  id "<<contig2node[order[i]]<<"\n";
+        g<<"  label \""<<contigs.name(order[i])<<"\""<<"\n";
+        g<<" ]"<<"\n";
+    }
+    for(int i = 0;i < int(bundled_links.size());i++)
+    {
+        const Link &l = bundled_links[i];
+        if (l.bundle_size >= cutoff)
+        {
+            g<<" edge ["<<"\n";
+            g<<"  source "<<contig2node[l.contig_a]<<"\n";
+            g<<"  target "<<contig2node[l.contig_b]<<"\n";
+            g<<"  mean "<<l.mean<<"\n";
+            g<<"  stdev "<<l.stdev<<"\n";
+            g<<"  bsize "<<l.bundle_size<<"\n";
+            g<<" ]"<<"\n";
+        }
+    }
+    g<<"]";
+}
+
+#endif
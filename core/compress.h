@@ -0,0 +1,412 @@
+#ifndef METACARVEL_COMPRESS_H
+#define METACARVEL_COMPRESS_H
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "resources.h"
+
+//Transparently compressed files. Inputs compressed with gzip or zstd are recognised by their
+//magic bytes and read through a decompressor, outputs whose name ends in .gz or .zst are written
+//through a compressor. The (de)compressors run as separate processes on Resources::threads():
+//BGZF files (bgzip, as used for BED and FASTA) are decompressed block-parallel by bgzip -@, other
+//gzip files by pigz, zstd frames by zstd -T. gzip is the fallback when neither bgzip nor pigz is
+//installed. Compressed output is written as BGZF when bgzip is there, so the next stage can
+//decompress it in parallel again.
+//
+//Inputs are read ahead (ReadAhead) while the tool parses what has arrived, so that waiting on a
+//slow or network filesystem and parsing overlap.
+
+//path quoted for /bin/sh
+inline std::string shell_quote(const std::string &path)
+{
+    std::string quoted = "'";
+    for(size_t i = 0; i < path.size(); i++)
+    {
+        if(path[i] == '\'')
+            quoted += "'\\''";
+        else
+            quoted += path[i];
+    }
+    return quoted + "'";
+}
+
+inline bool have_program(const std::string &name)
+{
+    static std::map<std::string,bool> found;
+    std::map<std::string,bool> :: iterator it = found.find(name);
+    if(it != found.end())
+        return it->second;
+    std::string cmd = "command -v " + name + " >/dev/null 2>&1";
+    return found[name] = (system(cmd.c_str()) == 0);
+}
+
+enum Compression {PLAIN, GZIP, BGZF, ZSTD};
+
+//compression of a file from its first bytes
+inline Compression file_compression(const std::string &path)
+{
+    unsigned char header[14] = {0};
+    FILE *f = fopen(path.c_str(), "rb");
+    if(f == NULL)
+        return PLAIN;
+    size_t n = fread(header, 1, sizeof(header), f);
+    fclose(f);
+    if(n >= 4 && header[0] == 0x28 && header[1] == 0xb5 && header[2] == 0x2f && header[3] == 0xfd)
+        return ZSTD;
+    if(n >= 2 && header[0] == 0x1f && header[1] == 0x8b)
+    {
+        //BGZF blocks are gzip members with a "BC" extra field
+        if(n >= 14 && (header[3] & 4) && header[12] == 'B' && header[13] == 'C')
+            return BGZF;
+        return GZIP;
+    }
+    return PLAIN;
+}
+
+inline bool ends_with(const std::string &s, const std::string &suffix)
+{
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+//Reads a file ahead of its consumer in blocks of BLOCK bytes, into a ring of DEPTH buffers that
+//are handed out in file order. Regular files are read by REQUESTS threads with pread, so that as
+//many requests are in flight at a time, the output of a decompressor by a single thread.
+class ReadAhead
+{
+public:
+    static const size_t BLOCK = 1 << 20;
+    static const int DEPTH = 8;
+    static const int REQUESTS = 4;
+    ReadAhead() : file(NULL) {}
+    ~ReadAhead() { stop(); }
+    void start(FILE *file);
+    //next block, false at the end of the file; the block of the previous call is given back
+    bool next(char *&data, size_t &size);
+    void stop();
+private:
+    class Slot
+    {
+    public:
+        std::vector<char> data;
+        size_t size;
+        long long block;     //block this slot is waiting for or holds
+        bool ready;
+    };
+    void read_blocks();
+    FILE *file;
+    bool seekable;
+    Slot slots[DEPTH];
+    long long claimed;       //blocks handed to the readers so far
+    long long consumed;      //blocks handed out by next
+    long long last;          //block holding the end of the file, once found
+    bool holding;            //the consumer still has block consumed - 1
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::thread> readers;
+};
+
+inline void ReadAhead :: start(FILE *f)
+{
+    file = f;
+    struct stat st;
+    seekable = fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode);
+#ifdef __linux__
+    if(seekable)
+        posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    for(int i = 0; i < DEPTH; i++)
+    {
+        slots[i].block = i;
+        slots[i].ready = false;
+    }
+    claimed = consumed = 0;
+    last = -1;
+    holding = false;
+    stopping = false;
+    for(int i = 0; i < (seekable ? REQUESTS : 1); i++)
+        readers.push_back(std::thread(&ReadAhead::read_blocks, this));
+}
+
+//A short read only happens at the end of the file, and the blocks after it are not read.
+//Read errors end the file, as they did for fread.
+inline void ReadAhead :: read_blocks()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true)
+    {
+        long long block = claimed++;
+        Slot &slot = slots[block % DEPTH];
+        changed.wait(lock, [&] { return stopping || (last != -1 && block > last) || slot.block == block; });
+        if(stopping || (last != -1 && block > last))
+            return;
+        lock.unlock();
+        slot.data.resize(BLOCK);
+        size_t size = 0;
+        while(size < BLOCK)
+        {
+            ssize_t n;
+            if(seekable)
+                n = pread(fileno(file), &slot.data[size], BLOCK - size, block * (long long)BLOCK + size);
+            else
+                n = fread(&slot.data[size], 1, BLOCK - size, file);
+            if(n <= 0)
+                break;
+            size += n;
+        }
+        lock.lock();
+        slot.size = size;
+        slot.ready = true;
+        if(size < BLOCK && (last == -1 || block < last))
+            last = block;
+        changed.notify_all();
+    }
+}
+
+inline bool ReadAhead :: next(char *&data, size_t &size)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if(holding)
+    {
+        Slot &previous = slots[(consumed - 1) % DEPTH];
+        previous.ready = false;
+        previous.block += DEPTH;
+        holding = false;
+        changed.notify_all();
+    }
+    if(last != -1 && consumed > last)
+        return false;
+    Slot &slot = slots[consumed % DEPTH];
+    changed.wait(lock, [&] { return slot.ready; });
+    consumed++;
+    holding = true;
+    data = &slot.data[0];
+    size = slot.size;
+    return size > 0;
+}
+
+inline void ReadAhead :: stop()
+{
+    if(file == NULL)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    for(int i = 0; i < int(readers.size()); i++)
+        readers[i].join();
+    readers.clear();
+    file = NULL;
+}
+
+//Buffered stream over a FILE*, either a plain file or the pipe to a (de)compressor.
+class PipeBuf : public std::streambuf
+{
+public:
+    PipeBuf() : file(NULL), piped(false), writing(false), at_end(false) {}
+    ~PipeBuf() { close(); }
+    bool open_read(const std::string &path);
+    bool open_write(const std::string &path);
+    bool close();
+protected:
+    int_type underflow();
+    int_type overflow(int_type c);
+    int sync();
+private:
+    bool flush_buffer();
+    FILE *file;
+    bool piped;
+    bool writing;
+    bool at_end;             //the reader got to the end of the file
+    std::string name;
+    char buffer[1 << 16];
+    ReadAhead ahead;
+};
+
+inline bool PipeBuf :: open_read(const std::string &path)
+{
+    name = path;
+    at_end = false;
+    std::ostringstream threads;
+    threads<<Resources::get().threads();
+    std::string cmd;
+    switch(file_compression(path))
+    {
+        case PLAIN:
+            break;
+        case BGZF:
+            if(have_program("bgzip"))
+            {
+                cmd = "bgzip -@ " + threads.str() + " -dc ";
+                break;
+            }
+            //fall through
+        case GZIP:
+            cmd = have_program("pigz") ? "pigz -dc " : "gzip -dc ";
+            break;
+        case ZSTD:
+            cmd = "zstd -dcq ";
+            break;
+    }
+    piped = cmd != "";
+    file = piped ? popen((cmd + shell_quote(path)).c_str(), "r") : fopen(path.c_str(), "r");
+    setg(buffer, buffer, buffer);
+    if(file != NULL)
+        ahead.start(file);
+    return file != NULL;
+}
+
+inline bool PipeBuf :: open_write(const std::string &path)
+{
+    name = path;
+    writing = true;
+    std::ostringstream threads;
+    threads<<Resources::get().threads();
+    std::string cmd;
+    if(ends_with(path, ".gz"))
+    {
+        if(have_program("bgzip"))
+            cmd = "bgzip -@ " + threads.str() + " -c";
+        else if(have_program("pigz"))
+            cmd = "pigz -p " + threads.str() + " -c";
+        else
+            cmd = "gzip -c";
+    }
+    else if(ends_with(path, ".zst"))
+    {
+        cmd = "zstd -q -T" + threads.str() + " -c";
+    }
+    piped = cmd != "";
+    file = piped ? popen((cmd + " > " + shell_quote(path)).c_str(), "w") : fopen(path.c_str(), "w");
+    setp(buffer, buffer + sizeof(buffer));
+    return file != NULL;
+}
+
+inline PipeBuf::int_type PipeBuf :: underflow()
+{
+    char *data;
+    size_t n;
+    if(file == NULL || !ahead.next(data, n))
+    {
+        at_end = true;
+        return traits_type::eof();
+    }
+    setg(data, data, data + n);
+    return traits_type::to_int_type(data[0]);
+}
+
+inline bool PipeBuf :: flush_buffer()
+{
+    size_t n = pptr() - pbase();
+    if(n > 0 && fwrite(pbase(), 1, n, file) != n)
+        return false;
+    setp(buffer, buffer + sizeof(buffer));
+    return true;
+}
+
+inline PipeBuf::int_type PipeBuf :: overflow(int_type c)
+{
+    if(file == NULL || !flush_buffer())
+        return traits_type::eof();
+    if(!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+inline int PipeBuf :: sync()
+{
+    if(writing && file != NULL && !flush_buffer())
+        return -1;
+    return 0;
+}
+
+//A decompressor or compressor that fails would leave a truncated file behind, so that is reported
+//and close() returns false. A reader that stops before the end of a compressed file breaks the
+//pipe of its decompressor, which is no error, so the status of a decompressor only counts once the
+//whole file was read, and plain and compressed files end the same way.
+inline bool PipeBuf :: close()
+{
+    if(file == NULL)
+        return true;
+    if(writing)
+        flush_buffer();
+    ahead.stop();
+    int status = piped ? pclose(file) : fclose(file);
+    file = NULL;
+    if(piped && status != 0 && (writing || at_end))
+    {
+        std::cerr<<"failed to "<<(writing ? "compress " : "decompress ")<<name<<std::endl;
+        return false;
+    }
+    return true;
+}
+
+//std::ifstream and std::ofstream replacements that handle compression.
+class InputFile : public std::istream
+{
+public:
+    explicit InputFile(const std::string &path) : std::istream(&buf)
+    {
+        if(!buf.open_read(path))
+            setstate(std::ios::failbit);
+    }
+    bool close()
+    {
+        if(buf.close())
+            return true;
+        setstate(std::ios::failbit);
+        return false;
+    }
+private:
+    PipeBuf buf;
+};
+
+class OutputFile : public std::ostream
+{
+public:
+    explicit OutputFile(const std::string &path) : std::ostream(&buf)
+    {
+        if(!buf.open_write(path))
+            setstate(std::ios::failbit);
+    }
+    bool close()
+    {
+        flush();
+        if(buf.close())
+            return true;
+        setstate(std::ios::failbit);
+        return false;
+    }
+private:
+    PipeBuf buf;
+};
+
+//Closes a file once it was read to the end or written and ends the tool if its decompressor or
+//compressor failed. Files left to their destructor only report the failure.
+template <class File>
+inline void close_or_exit(File &file)
+{
+    if(!file.close())
+        exit(1);
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef METACARVEL_CONTIGS_H
+#define METACARVEL_CONTIGS_H
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "compress.h"
+#include "stats.h"
+
+//Interned contig names. Every stage refers to a contig by its dense id, the name is only
+//looked up again when writing output.
+class ContigTable
+{
+private:
+    std::vector<std::string> names;
+    std::vector<int> lengths;
+    std::vector<bool> known_length;
+    std::unordered_map<std::string, int> ids;
+public:
+    int intern(const std::string &name);
+    int find(const std::string &name) const;
+    const std::string &name(int id) const;
+    int size() const;
+    int length(int id) const;
+    bool has_length(int id) const;
+    void set_length(int id, int length);
+    std::vector<int> by_name() const;
+};
+
+inline int ContigTable :: intern(const std::string &name)
+{
+    std::unordered_map<std::string, int> :: iterator it = ids.find(name);
+    if(it != ids.end())
+        return it->second;
+    int id = names.size();
+    ids[name] = id;
+    names.push_back(name);
+    lengths.push_back(0);
+    known_length.push_back(false);
+    return id;
+}
+
+inline int ContigTable :: find(const std::string &name) const
+{
+    std::unordered_map<std::string, int> :: const_iterator it = ids.find(name);
+    if(it == ids.end())
+        return -1;
+    return it->second;
+}
+
+inline const std::string &ContigTable :: name(int id) const
+{
+    return names[id];
+}
+
+inline int ContigTable :: size() const
+{
+    return names.size();
+}
+
+//contigs missing from the length file have length 0, like a lookup in the old map<string,int>
+inline int ContigTable :: length(int id) const
+{
+    return lengths[id];
+}
+
+inline bool ContigTable :: has_length(int id) const
+{
+    return known_length[id];
+}
+
+inline void ContigTable :: set_length(int id, int length)
+{
+    lengths[id] = length;
+    known_length[id] = true;
+}
+
+//ids in lexicographic order of names, the order in which the tools always wrote their output
+inline std::vector<int> ContigTable :: by_name() const
+{
+    std::vector<int> order(names.size());
+    for(int i = 0; i < int(order.size()); i++)
+        order[i] = i;
+    const std::vector<std::string> &n = names;
+    std::sort(order.begin(), order.end(), [&n](int a, int b) { return n[a] < n[b]; });
+    return order;
+}
+
+inline void load_contig_lengths(const std::string &file, ContigTable &contigs)
+{
+    ScopedTimer timer("load lengths");
+    InputFile lenfile(file);
+    std::string line;
+    while(getline(lenfile,line))
+    {
+        std::istringstream iss(line);
+        std::string contig;
+        int len;
+        if(!(iss >> contig >> len))
+            continue;
+        contigs.set_length(contigs.intern(contig), len);
+    }
+    close_or_exit(lenfile);
+}
+
+#endif
@@ -0,0 +1,784 @@
+#ifndef METACARVEL_CORRECT_H
+#define METACARVEL_CORRECT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bloom.h"
+#include "contigs.h"
+#include "links.h"
+#include "resources.h"
+
+//Link generation from read alignments (libcorrect).
+
+class BedRecord
+{
+public:
+    int contig;
+    int start;
+    int end;
+    char strand;//+ forward - reverse
+    BedRecord () {}
+    BedRecord(int contig, int start, int end, char strand);
+};
+
+inline BedRecord :: BedRecord(int contig, int start, int end, char strand)
+{
+    this->contig = contig;
+    this->start = start;
+    this->end = end;
+    this->strand = strand;
+}
+
+//mates of every read, keyed by read name without the /1 /2 suffix
+class ReadPairs
+{
+public:
+    std::map<std::string, BedRecord> first_in_pair;
+    std::map<std::string, BedRecord> second_in_pair;
+};
+
+class InsertModel
+{
+public:
+    double sum;
+    int count;
+    double mean;
+    double stdev;
+};
+
+//mate key of a read, its name without the /1 /2 suffix, the way parse_bed keys the maps
+inline std::string mate_key(const std::string &read)
+{
+    if(read.length() > 2 && read[read.length()-2] == '/')
+        return read.substr(0, read.length()-2);
+    return read;
+}
+
+inline void parse_bed(std::istream &bedfile, ContigTable &contigs, ReadPairs &pairs, const CountingBloom *mates = NULL)
+{
+    ScopedTimer timer("parse alignments");
+    long long alignments = 0, singletons = 0;
+    std::string line;
+    std::unordered_map<std::string,int> seen;
+    while(getline(bedfile,line))
+    {
+        std::string contig, read;
+        char strand;
+        int start,end,flag;
+        std::istringstream iss(line);
+        if(!(iss >> contig >> start >> end >> read >> flag >> strand))
+            continue;
+        alignments++;
+        BedRecord rec(contigs.intern(contig),start,end,strand);
+        if(mates != NULL && !mates->seen_twice(mate_key(read)))
+        {
+            singletons++;
+            continue;
+        }
+        if(read.length() > 2 && read[read.length()-2] == '/')
+        {
+            if(read[read.length() -1 ] == '1')
+            {
+                pairs.first_in_pair[read.substr(0,read.length()-2)] = rec;
+            }
+            else
+            {
+                pairs.second_in_pair[read.substr(0,read.length()-2)] = rec;
+            }
+        }
+        else
+        {
+            if(seen.find(read) == seen.end())
+            {
+                pairs.first_in_pair[read] = rec;
+                seen[read] = true;
+            }
+            else
+            {
+                pairs.second_in_pair[read] = rec;
+            }
+        }
+    }
+    Stats::get().count("alignments", alignments);
+    if(mates != NULL)
+        Stats::get().count("singletons skipped", singletons);
+}
+
+//First pass of the prefilter: every mate key of the file in a counting Bloom filter, so that the
+//second pass only stores reads that occur at least twice, skipping those whose mate was not
+//aligned. The filter is sized from the file, a BED line taking at least 30 bytes (6 compressed).
+inline CountingBloom count_mate_keys(const std::string &path)
+{
+    ScopedTimer timer("prefilter");
+    std::ifstream size(path.c_str(), std::ios::binary | std::ios::ate);
+    long long bytes = size ? (long long)size.tellg() : 0;
+    CountingBloom mates(bytes / (file_compression(path) == PLAIN ? 30 : 6));
+    InputFile bedfile(path);
+    std::string line;
+    while(getline(bedfile,line))
+    {
+        std::string contig, read;
+        int start,end;
+        std::istringstream iss(line);
+        if(iss >> contig >> start >> end >> read)
+            mates.add(mate_key(read));
+    }
+    close_or_exit(bedfile);
+    return mates;
+}
+
+inline void parse_bed(const std::string &path, ContigTable &contigs, ReadPairs &pairs, bool prefilter = false)
+{
+    if(prefilter)
+    {
+        CountingBloom mates = count_mate_keys(path);
+        InputFile bedfile(path);
+        parse_bed(bedfile, contigs, pairs, &mates);
+        close_or_exit(bedfile);
+        return;
+    }
+    InputFile bedfile(path);
+    parse_bed(bedfile, contigs, pairs);
+    close_or_exit(bedfile);
+}
+
+inline int get_insert_size(int start1, int end1, int start2, int end2)
+{
+    if(start1 <= start2)
+    {
+        return end2 - start1 + 1;
+    }
+    else
+    {
+        return end1 - start2 + 1;
+    }
+}
+
+inline double estimate_distance(double mean, int start1, int end1, int start2, int end2, int ctg1_length, int ctg2_length, char end_a, char end_b)
+{
+    int read1_length = end1 - start1 + 1;
+    int read2_length = end2 - start2 + 1;
+    int offset1 = 0,offset2 = 0;
+
+    if(end_a == 'E' && end_b == 'B')
+    {
+        offset1 = ctg1_length - end1;
+        offset2 = start2;
+    }
+    //Need to work out BB and EE properly with reasoning
+    if(end_a == 'B' && end_b == 'B')
+    {
+        offset1 = start1;
+        offset2 = start2;
+    }
+    if(end_a == 'E' && end_b == 'E')
+    {
+        offset1 = ctg1_length - end1;
+        offset2 = ctg2_length - end2;
+    }
+    if(end_a == 'B' && end_b == 'E')
+    {
+        offset1 = start1;
+        offset2 = ctg2_length - end2;
+    }
+
+    return mean - read1_length - read2_length - offset2 - offset1;
+}
+
+//Insert sizes of the pairs with both mates on the same contig, counted per contig in
+//contig_reads, which is what coverage is computed from.
+inline void collect_insert_sizes(const ReadPairs &pairs, std::vector<int> &contig_reads, std::vector<int> &insert_sizes)
+{
+    std::map<std::string,BedRecord> :: const_iterator it, mate;
+    for(it = pairs.first_in_pair.begin(); it != pairs.first_in_pair.end(); ++it)
+    {
+        mate = pairs.second_in_pair.find(it->first);
+        if(mate == pairs.second_in_pair.end())
+            continue;
+        const BedRecord &first = it->second;
+        const BedRecord &second = mate->second;
+        if(first.contig == second.contig)
+        {
+            contig_reads[first.contig] += 1;
+            insert_sizes.push_back(get_insert_size(first.start, first.end, second.start, second.end));
+        }
+    }
+}
+
+inline InsertModel insert_model(const std::vector<int> &insert_sizes)
+{
+    InsertModel model;
+    model.sum = std::accumulate(insert_sizes.begin(), insert_sizes.end(), 0.0);
+    model.count = insert_sizes.size();
+    model.mean = model.sum / insert_sizes.size();
+
+    std::vector<double> diff(insert_sizes.size());
+    std::transform(insert_sizes.begin(), insert_sizes.end(), diff.begin(), [&model](int x) { return x - model.mean; });
+    double sq_sum = std::inner_product(diff.begin(), diff.end(), diff.begin(), 0.0);
+    model.stdev = std::sqrt(sq_sum / insert_sizes.size());
+    Stats::get().count("same contig pairs", model.count);
+    return model;
+}
+
+//Insert size distribution from pairs with both mates on the same contig.
+inline InsertModel estimate_insert_size(const ReadPairs &pairs, int ncontigs, std::vector<int> &contig_reads)
+{
+    ScopedTimer timer("insert size");
+    std::vector<int> insert_sizes;
+    contig_reads.assign(ncontigs, 0);
+    collect_insert_sizes(pairs, contig_reads, insert_sizes);
+    return insert_model(insert_sizes);
+}
+
+inline void write_coverage(std::ostream &covfile, const ContigTable &contigs, const std::vector<int> &contig_reads, double mean)
+{
+    ScopedTimer timer("write coverage");
+    std::vector<int> order = contigs.by_name();
+    for(int i = 0; i < int(order.size()); i++)
+    {
+        int c = order[i];
+        if(contig_reads[c] == 0)
+            continue;
+        int len = contigs.length(c);
+        double coverage = contig_reads[c] * 1.0 * mean / len;
+        covfile<<contigs.name(c)<<"\t"<<coverage<<"\n";
+    }
+}
+
+//Which read pairs become links. Both contigs have to be longer than length_cutoff. With
+//end_proximity k > 0 the reads also have to lie close enough to the linked contig ends: a pair
+//whose reads and end offsets span more than mean + k stdev of the insert size implies a gap below
+//-k stdev, which bundling and repeat filtering would discard anyway, so it is dropped right here.
+//With collapse_duplicates only the first of the pairs aligned to the same positions makes a link.
+//max_links > 0 caps the links kept per contig pair and orientation (see LinkReservoir).
+class LinkCriteria
+{
+public:
+    int length_cutoff;
+    double end_proximity;
+    bool collapse_duplicates;
+    int max_links;
+    LinkCriteria(int length_cutoff, double end_proximity = 0, bool collapse_duplicates = false, int max_links = 0) : length_cutoff(length_cutoff), end_proximity(end_proximity), collapse_duplicates(collapse_duplicates), max_links(max_links) {}
+};
+
+//PCR and optical duplicates of a fragment align to the same positions and would each add a link,
+//inflating bundle sizes. A pair is identified by the contig, 5' position and strand of both reads,
+//packed into 64 bits each and ordered so that a duplicate with the mates swapped matches too.
+//The keys live in a flat table probed linearly, 16 bytes a slot and at most half full. The table
+//may take a quarter of the memory budget, the mates it is checked for hold the rest. Once it can
+//not grow, new keys are no longer stored and their duplicates are kept as links.
+class DuplicatePairs
+{
+public:
+    DuplicatePairs() : duplicates(0), unstored(0), used(0), slots(1024) {}
+    //true if a pair at the same positions was seen before
+    bool seen(const BedRecord &first, const BedRecord &second);
+    long long duplicates;
+    long long unstored;
+private:
+    static const unsigned long long EMPTY = ~0ULL;       //no read has contig 0xffffffff
+    struct Slot
+    {
+        unsigned long long a, b;
+        Slot() : a(EMPTY), b(EMPTY) {}
+    };
+    static unsigned long long position(const BedRecord &rec)
+    {
+        unsigned long long five_prime = (rec.strand == '-') ? rec.end : rec.start;
+        return ((unsigned long long)(unsigned int)rec.contig << 32) | ((five_prime & 0x7fffffffULL) << 1) | (rec.strand == '-');
+    }
+    static unsigned long long hash(unsigned long long a, unsigned long long b)
+    {
+        unsigned long long h = a * 0x9e3779b97f4a7c15ULL ^ b;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+    size_t find(unsigned long long a, unsigned long long b) const;
+    bool grow();
+    size_t used;
+    std::vector<Slot> slots;
+};
+
+//slot of the key, or the empty slot it would go to
+inline size_t DuplicatePairs :: find(unsigned long long a, unsigned long long b) const
+{
+    size_t mask = slots.size() - 1;
+    size_t i = hash(a, b) & mask;
+    while(slots[i].a != EMPTY && (slots[i].a != a || slots[i].b != b))
+        i = (i + 1) & mask;
+    return i;
+}
+
+inline bool DuplicatePairs :: grow()
+{
+    unsigned long long bytes = 2 * slots.size() * sizeof(Slot);
+    if(!Resources::get().fits(4 * bytes))
+        return false;
+    std::vector<Slot> previous(2 * slots.size());
+    previous.swap(slots);
+    for(size_t i = 0; i < previous.size(); i++)
+        if(previous[i].a != EMPTY)
+            slots[find(previous[i].a, previous[i].b)] = previous[i];
+    return true;
+}
+
+inline bool DuplicatePairs :: seen(const BedRecord &first, const BedRecord &second)
+{
+    unsigned long long a = position(first), b = position(second);
+    if(a > b)
+        std::swap(a, b);
+    size_t i = find(a, b);
+    if(slots[i].a != EMPTY)
+    {
+        duplicates++;
+        return true;
+    }
+    if(2 * (used + 1) > slots.size())
+    {
+        if(!grow())
+        {
+            unstored++;
+            return false;
+        }
+        i = find(a, b);
+    }
+    slots[i].a = a;
+    slots[i].b = b;
+    used++;
+    return false;
+}
+
+//The link of one read pair, false if the pair does not meet the criteria
+inline bool pair_link(const BedRecord &first, const BedRecord &second, const ContigTable &contigs, const InsertModel &model, const LinkCriteria &criteria, Link &l)
+{
+    if(contigs.length(first.contig) <= criteria.length_cutoff || contigs.length(second.contig) <= criteria.length_cutoff)
+    {
+        return false;
+    }
+    if(first.contig == second.contig)
+        return false;
+    if((first.strand != '+' && first.strand != '-') || (second.strand != '+' && second.strand != '-'))
+        return false;
+    l.contig_a = first.contig;
+    l.contig_b = second.contig;
+    l.end_a = (first.strand == '+') ? 'E' : 'B';
+    l.end_b = (second.strand == '+') ? 'E' : 'B';
+    l.mean = estimate_distance(model.mean,first.start,first.end,second.start,second.end,contigs.length(first.contig),contigs.length(second.contig),l.end_a,l.end_b);
+    if(criteria.end_proximity > 0 && l.mean < -criteria.end_proximity * model.stdev)
+        return false;
+    l.stdev = model.stdev;
+    l.bundle_size = 1;
+    return true;
+}
+
+//Pairs of high copy contigs (phages, rRNA operons, plasmids) can be linked by hundreds of thousands
+//of read pairs, all of which bundler would sweep although a few thousand give the same bundle.
+//With a cap, each contig pair and orientation keeps a uniform sample of at most cap of its links,
+//drawn by reservoir sampling as the links are generated, with a fixed seed so that runs repeat.
+//finish() spreads the true number of read pairs over the sampled links as their bundle_size, so
+//the bundle still reports its full support. Without a cap links are simply appended.
+class LinkReservoir
+{
+public:
+    LinkReservoir(LinkArray &links, int cap) : links(links), cap(cap), rng(0) {}
+    void add(const Link &l);
+    void finish();
+private:
+    struct Group
+    {
+        long long seen;
+        std::vector<int> slots;
+        Group() : seen(0) {}
+    };
+    LinkArray &links;
+    int cap;
+    std::unordered_map<LinkKey, Group, LinkKey::Hash> groups;
+    std::mt19937_64 rng;
+};
+
+inline void LinkReservoir :: add(const Link &l)
+{
+    if(cap <= 0)
+    {
+        links.push_back(l);
+        return;
+    }
+    Group &g = groups[LinkKey(l)];
+    g.seen++;
+    if(int(g.slots.size()) < cap)
+    {
+        g.slots.push_back(links.size());
+        links.push_back(l);
+        return;
+    }
+    long long r = std::uniform_int_distribution<long long>(0, g.seen - 1)(rng);
+    if(r < cap)
+        links[g.slots[r]] = l;
+}
+
+inline void LinkReservoir :: finish()
+{
+    long long capped = 0, dropped = 0;
+    std::unordered_map<LinkKey, Group, LinkKey::Hash> :: const_iterator it;
+    for(it = groups.begin(); it != groups.end(); ++it)
+    {
+        const Group &g = it->second;
+        if(g.seen <= cap)
+            continue;
+        capped++;
+        dropped += g.seen - cap;
+        for(int i = 0; i < cap; i++)
+            links[g.slots[i]].bundle_size = g.seen / cap + (i < g.seen % cap);
+    }
+    if(cap > 0)
+    {
+        Stats::get().count("capped contig pairs", capped);
+        Stats::get().count("links dropped by cap", dropped);
+    }
+}
+
+//calculate links between contigs based on mate pair information, iterate through maps of mate pairs and find links
+inline void generate_links(const ReadPairs &pairs, const ContigTable &contigs, const InsertModel &model, const LinkCriteria &criteria, LinkArray &links)
+{
+    ScopedTimer timer("generate links");
+    DuplicatePairs duplicates;
+    LinkReservoir reservoir(links, criteria.max_links);
+    std::map<std::string,BedRecord> :: const_iterator it, mate;
+    for(it = pairs.first_in_pair.begin(); it != pairs.first_in_pair.end(); ++it)
+    {
+        mate = pairs.second_in_pair.find(it->first);
+        if(mate == pairs.second_in_pair.end())
+            continue;
+        Link l;
+        if(pair_link(it->second, mate->second, contigs, model, criteria, l) && !(criteria.collapse_duplicates && duplicates.seen(it->second, mate->second)))
+            reservoir.add(l);
+    }
+    reservoir.finish();
+    Stats::get().count("links generated", links.size());
+    if(criteria.collapse_duplicates)
+    {
+        Stats::get().count("duplicate pairs collapsed", duplicates.duplicates);
+        Stats::get().count("pairs past the duplicate table", duplicates.unstored);
+    }
+}
+
+//At most this many spill files are written at once, more partitions take several passes over the
+//alignments so that the tool stays well within the open file limit. Budgets so small that even
+//MAX_SPILL_PASSES passes do not split the alignments finely enough get partitions larger than the budget.
+const int MAX_OPEN_SPILLS = 256;
+const int MAX_SPILL_PASSES = 16;
+
+//The maps of mates take about twice the size of the BED file, ten times the size of a compressed
+//one. Returns how many partitions the alignments have to be split into for each one to fit the
+//memory budget, 1 if they fit as a whole.
+inline int pairing_partitions(const std::string &path)
+{
+    std::ifstream bed(path.c_str(), std::ios::binary | std::ios::ate);
+    if(!bed)
+        return 1;
+    unsigned long long estimate = (file_compression(path) == PLAIN ? 2ULL : 10ULL) * (unsigned long long)bed.tellg();
+    if(Resources::get().fits(estimate))
+        return 1;
+    unsigned long long budget = Resources::get().memory();
+    return int(std::min((estimate + budget - 1) / budget, (unsigned long long)MAX_OPEN_SPILLS * MAX_SPILL_PASSES));
+}
+
+//Pairs found outside the maps of ReadPairs, by partition or by joining mate files. Same contig
+//pairs feed the insert size model and coverage right away. Pairs linking two contigs are kept with
+//their key and turned into links once the insert size of the whole library is known, in key order
+//like generate_links.
+class PairCollector
+{
+public:
+    std::vector<int> contig_reads;
+    void add(const std::string &key, const BedRecord &first, const BedRecord &second);
+    InsertModel finish(const ContigTable &contigs, const LinkCriteria &criteria, LinkArray &links);
+private:
+    std::vector<int> insert_sizes;
+    std::vector<std::pair<std::string, std::pair<BedRecord,BedRecord> > > linking;
+};
+
+inline void PairCollector :: add(const std::string &key, const BedRecord &first, const BedRecord &second)
+{
+    if(first.contig == second.contig)
+    {
+        if(first.contig >= int(contig_reads.size()))
+            contig_reads.resize(first.contig + 1, 0);
+        contig_reads[first.contig] += 1;
+        insert_sizes.push_back(get_insert_size(first.start, first.end, second.start, second.end));
+    }
+    else
+    {
+        linking.push_back(std::make_pair(key, std::make_pair(first, second)));
+    }
+}
+
+inline InsertModel PairCollector :: finish(const ContigTable &contigs, const LinkCriteria &criteria, LinkArray &links)
+{
+    contig_reads.resize(contigs.size(), 0);
+    InsertModel model = insert_model(insert_sizes);
+
+    ScopedTimer timer("generate links");
+    std::sort(linking.begin(), linking.end(), [](const std::pair<std::string, std::pair<BedRecord,BedRecord> > &a, const std::pair<std::string, std::pair<BedRecord,BedRecord> > &b) { return a.first < b.first; });
+    DuplicatePairs duplicates;
+    LinkReservoir reservoir(links, criteria.max_links);
+    for(int i = 0; i < int(linking.size()); i++)
+    {
+        const BedRecord &first = linking[i].second.first, &second = linking[i].second.second;
+        Link l;
+        if(pair_link(first, second, contigs, model, criteria, l) && !(criteria.collapse_duplicates && duplicates.seen(first, second)))
+            reservoir.add(l);
+    }
+    reservoir.finish();
+    Stats::get().count("links generated", links.size());
+    if(criteria.collapse_duplicates)
+    {
+        Stats::get().count("duplicate pairs collapsed", duplicates.duplicates);
+        Stats::get().count("pairs past the duplicate table", duplicates.unstored);
+    }
+    return model;
+}
+
+//Removes the spill files and ends the tool, after a spill file could not be written or the
+//alignments not be read to the end.
+inline void spill_failed(const std::vector<std::string> &files, const std::string &message)
+{
+    std::cerr<<message<<std::endl;
+    for(int p = 0; p < int(files.size()); p++)
+        remove(files[p].c_str());
+    exit(1);
+}
+
+//Spilling version of parse_bed, estimate_insert_size and generate_links for alignments that do
+//not fit the memory budget. The alignments are split by a hash of the mate key into parts files
+//named spill_prefix.N, both mates of a read landing in the same one, and the partitions are paired
+//one at a time. prefilter drops singletons as in parse_bed.
+inline InsertModel pair_partitioned(const std::string &path, const std::string &spill_prefix, int parts, bool prefilter, ContigTable &contigs, const LinkCriteria &criteria, std::vector<int> &contig_reads, LinkArray &links, long long &first_mates, long long &second_mates)
+{
+    std::vector<std::string> files(parts);
+    for(int p = 0; p < parts; p++)
+    {
+        std::ostringstream name;
+        name<<spill_prefix<<"."<<p;
+        files[p] = name.str();
+    }
+    {
+        //with the prefilter, singletons are not even spilled
+        CountingBloom mates = prefilter ? count_mate_keys(path) : CountingBloom(0);
+        ScopedTimer timer("split alignments");
+        std::hash<std::string> hash;
+        int passes = 0;
+        for(int first = 0; first < parts; first += MAX_OPEN_SPILLS, passes++)
+        {
+            int last = std::min(parts, first + MAX_OPEN_SPILLS);
+            std::vector<std::unique_ptr<std::ofstream> > out;
+            for(int p = first; p < last; p++)
+            {
+                out.push_back(std::unique_ptr<std::ofstream>(new std::ofstream(files[p].c_str())));
+                if(!*out.back())
+                    spill_failed(files, "failed to open spill file " + files[p]);
+            }
+            InputFile bedfile(path);
+            std::string line;
+            while(getline(bedfile,line))
+            {
+                std::string contig, read;
+                int start,end;
+                std::istringstream iss(line);
+                if(!(iss >> contig >> start >> end >> read))
+                    continue;
+                std::string key = mate_key(read);
+                if(prefilter && !mates.seen_twice(key))
+                    continue;
+                int part = hash(key) % parts;
+                if(part >= first && part < last)
+                    *out[part - first]<<line<<"\n";
+            }
+            if(!bedfile.close())
+                spill_failed(files, "failed to split " + path);
+            for(int p = first; p < last; p++)
+            {
+                out[p - first]->close();
+                if(!*out[p - first])
+                    spill_failed(files, "failed to write spill file " + files[p]);
+            }
+        }
+        Stats::get().count("spill partitions", parts);
+        Stats::get().count("spill passes", passes);
+    }
+
+    PairCollector collector;
+    first_mates = second_mates = 0;
+    for(int p = 0; p < parts; p++)
+    {
+        ReadPairs pairs;
+        parse_bed(files[p], contigs, pairs);
+        remove(files[p].c_str());
+        first_mates += pairs.first_in_pair.size();
+        second_mates += pairs.second_in_pair.size();
+        ScopedTimer timer("insert size");
+        std::map<std::string,BedRecord> :: const_iterator it, mate;
+        for(it = pairs.first_in_pair.begin(); it != pairs.first_in_pair.end(); ++it)
+        {
+            mate = pairs.second_in_pair.find(it->first);
+            if(mate != pairs.second_in_pair.end())
+                collector.add(it->first, it->second, mate->second);
+        }
+    }
+    InsertModel model = collector.finish(contigs, criteria, links);
+    contig_reads.swap(collector.contig_reads);
+    return model;
+}
+
+//Reads the alignments of one mate file a read at a time. Consecutive alignments of the same read
+//collapse to the last one, which is the one the maps of parse_bed would keep.
+class MateStream
+{
+public:
+    MateStream(const std::string &path, ContigTable &contigs);
+    bool next(std::string &key, BedRecord &rec);
+    long long reads;
+    long long alignments;
+private:
+    bool parse(std::string &key, BedRecord &rec);
+    InputFile in;
+    ContigTable &contigs;
+    bool ahead;
+    std::string ahead_key;
+    BedRecord ahead_rec;
+};
+
+inline MateStream :: MateStream(const std::string &path, ContigTable &contigs) : reads(0), alignments(0), in(path), contigs(contigs)
+{
+    ahead = parse(ahead_key, ahead_rec);
+}
+
+inline bool MateStream :: parse(std::string &key, BedRecord &rec)
+{
+    std::string line;
+    while(getline(in,line))
+    {
+        std::string contig, read;
+        char strand;
+        int start,end,flag;
+        std::istringstream iss(line);
+        if(!(iss >> contig >> start >> end >> read >> flag >> strand))
+            continue;
+        alignments++;
+        key = mate_key(read);
+        rec = BedRecord(contigs.intern(contig),start,end,strand);
+        return true;
+    }
+    close_or_exit(in);
+    return false;
+}
+
+inline bool MateStream :: next(std::string &key, BedRecord &rec)
+{
+    if(!ahead)
+        return false;
+    key = ahead_key;
+    rec = ahead_rec;
+    while((ahead = parse(ahead_key, ahead_rec)) && ahead_key == key)
+        rec = ahead_rec;
+    reads++;
+    return true;
+}
+
+//Joins the alignments of first and second mates mapped as single end reads into separate files,
+//replacing the merge and name sort of a combined file. The first file is the first mate of every
+//pair, whatever the read names say.
+//
+//By default the first file is held in a hash table keyed by read name and the second streamed
+//against it. With ordered, the aligner is trusted to have kept the input order of the reads, so
+//the files are read in lockstep and a read still waiting for its mate is dropped once a later
+//read of the other file found its own: its mate was not aligned. Memory then only holds the
+//reads between two pairs instead of a whole file.
+inline InsertModel pair_mate_files(const std::string &path1, const std::string &path2, bool ordered, ContigTable &contigs, const LinkCriteria &criteria, std::vector<int> &contig_reads, LinkArray &links, long long &first_mates, long long &second_mates)
+{
+    ScopedTimer timer("join mates");
+    PairCollector collector;
+    MateStream first(path1, contigs), second(path2, contigs);
+    std::string key;
+    BedRecord rec;
+    if(!ordered)
+    {
+        std::unordered_map<std::string,BedRecord> firsts, seconds;
+        while(first.next(key, rec))
+            firsts[key] = rec;
+        while(second.next(key, rec))
+            if(firsts.find(key) != firsts.end())
+                seconds[key] = rec;
+        std::unordered_map<std::string,BedRecord> :: const_iterator it;
+        for(it = seconds.begin(); it != seconds.end(); ++it)
+            collector.add(it->first, firsts[it->first], it->second);
+        first_mates = firsts.size();
+        second_mates = second.reads;
+    }
+    else
+    {
+        //reads waiting for their mate, by key with their position in the file, and in file order
+        std::unordered_map<std::string, std::pair<long long,BedRecord> > waiting[2];
+        std::deque<std::pair<long long,std::string> > order[2];
+        MateStream *streams[2] = {&first, &second};
+        long long position[2] = {0, 0};
+        bool more[2] = {true, true};
+        long long most_waiting = 0;
+        for(int side = 0; more[0] || more[1]; side = 1 - side)
+        {
+            if(!more[side] || !(more[side] = streams[side]->next(key, rec)))
+                continue;
+            int other = 1 - side;
+            std::unordered_map<std::string, std::pair<long long,BedRecord> > :: iterator mate = waiting[other].find(key);
+            if(mate == waiting[other].end())
+            {
+                waiting[side][key] = std::make_pair(position[side], rec);
+                order[side].push_back(std::make_pair(position[side]++, key));
+                most_waiting = std::max(most_waiting, (long long)(waiting[0].size() + waiting[1].size()));
+                continue;
+            }
+            position[side]++;
+            long long matched = mate->second.first;
+            if(side == 0)
+                collector.add(key, rec, mate->second.second);
+            else
+                collector.add(key, mate->second.second, rec);
+            waiting[other].erase(mate);
+            //everything before the mate on the other side, and everything waiting on this one, has no mate
+            while(!order[other].empty() && order[other].front().first <= matched)
+            {
+                std::unordered_map<std::string, std::pair<long long,BedRecord> > :: iterator w = waiting[other].find(order[other].front().second);
+                if(w != waiting[other].end() && w->second.first == order[other].front().first)
+                    waiting[other].erase(w);
+                order[other].pop_front();
+            }
+            waiting[side].clear();
+            order[side].clear();
+        }
+        first_mates = first.reads;
+        second_mates = second.reads;
+        Stats::get().count("most reads waiting", most_waiting);
+    }
+    Stats::get().count("alignments", first.alignments + second.alignments);
+    timer.stop();
+    InsertModel model = collector.finish(contigs, criteria, links);
+    contig_reads.swap(collector.contig_reads);
+    return model;
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef METACARVEL_GML_H
+#define METACARVEL_GML_H
+
+#include <string>
+
+#include <ogdf/basic/Graph.h>
+#include <ogdf/fileformats/GmlStreamParser.h>
+
+#include "compress.h"
+#include "contigs.h"
+#include "links.h"
+#include "stats.h"
+
+//Links of an oriented.gml (orientcontigs -o), read in a single pass by OGDF's GmlStreamParser.
+//Contigs are interned in the order their links name them and contigs without links are left out,
+//as when reading oriented_links, so the tools see the same contig ids and links either way.
+inline bool read_oriented_gml(const std::string &path, ContigTable &contigs, LinkArray &links)
+{
+    ScopedTimer timer("read links");
+    InputFile in(path);
+    ogdf::Graph G;
+    ogdf::GmlStreamParser parser(in);
+    if(!in || !parser.read(G))
+        return false;
+    close_or_exit(in);
+    size_t before = links.size();
+    for(ogdf::edge e : G.edges)
+    {
+        const std::string &o = parser.edgeOrientation()[e];
+        if(o.size() != 2)
+            return false;
+        Link l;
+        l.contig_a = contigs.intern(parser.label()[e->source()]);
+        l.end_a = o[0];
+        l.contig_b = contigs.intern(parser.label()[e->target()]);
+        l.end_b = o[1];
+        l.mean = parser.mean()[e];
+        l.stdev = parser.stdev()[e];
+        l.bundle_size = parser.bsize()[e];
+        contigs.set_length(l.contig_a, parser.length()[e->source()]);
+        contigs.set_length(l.contig_b, parser.length()[e->target()]);
+        links.push_back(l);
+    }
+    Stats::get().count("links read", links.size() - before);
+    return true;
+}
+
+#endif
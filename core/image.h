@@ -0,0 +1,210 @@
+#ifndef METACARVEL_IMAGE_H
+#define METACARVEL_IMAGE_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "contigs.h"
+#include "links.h"
+#include "stats.h"
+
+//Flat binary images of the in-memory graph structures, laid out so that readers can mmap the
+//file and use every array in place (graphimage.py does this for the Python stages). Writing the
+//image to /dev/shm hands the graph to the next stage through shared memory.
+//
+//Layout, all little endian as written by the host:
+//  header   "MCGI", uint32 version, uint32 number of sections, char kind[20]
+//  sections one entry per array: char name[24], char type, 7 bytes padding, uint64 count, uint64 offset
+//  data     the arrays, each starting at an 8 byte aligned offset
+//Types are 'i' int32, 'q' int64, 'd' double and 'B' unsigned char, as in Python's struct module.
+
+const unsigned int IMAGE_VERSION = 1;
+
+//Sections point to the arrays they were added from, which are written in place, so those have to
+//outlive write(). A file that can not be written ends the tool, leaving no partial image behind.
+class ImageWriter
+{
+public:
+    ImageWriter(const std::string &kind) : kind(kind) {}
+    void add(const char *name, const std::vector<int> &v) { add(name, 'i', v.data(), v.size(), sizeof(int)); }
+    void add(const char *name, const std::vector<long long> &v) { add(name, 'q', v.data(), v.size(), sizeof(long long)); }
+    void add(const char *name, const std::vector<double> &v) { add(name, 'd', v.data(), v.size(), sizeof(double)); }
+    void add(const char *name, const std::vector<unsigned char> &v) { add(name, 'B', v.data(), v.size(), 1); }
+    void write(const std::string &path) const;
+private:
+    class Section
+    {
+    public:
+        std::string name;
+        char type;
+        unsigned long long count;
+        const char *data;
+        size_t bytes;
+    };
+    void add(const char *name, char type, const void *data, size_t count, size_t width);
+    static void failed(const std::string &path);
+    std::string kind;
+    std::vector<Section> sections;
+};
+
+inline void ImageWriter :: add(const char *name, char type, const void *data, size_t count, size_t width)
+{
+    Section s;
+    s.name = name;
+    s.type = type;
+    s.count = count;
+    s.data = (const char*)data;
+    s.bytes = count * width;
+    sections.push_back(s);
+}
+
+inline void ImageWriter :: failed(const std::string &path)
+{
+    std::cerr<<"failed to write image "<<path<<std::endl;
+    remove(path.c_str());
+    exit(1);
+}
+
+inline void ImageWriter :: write(const std::string &path) const
+{
+    ScopedTimer timer("write image");
+    const size_t header = 32, entry = 48;
+    std::string table(header + entry * sections.size(), '\0');
+    memcpy(&table[0], "MCGI", 4);
+    unsigned int version = IMAGE_VERSION, nsections = sections.size();
+    memcpy(&table[4], &version, 4);
+    memcpy(&table[8], &nsections, 4);
+    strncpy(&table[12], kind.c_str(), 19);
+    std::vector<unsigned long long> offsets(sections.size());
+    unsigned long long offset = table.size();
+    for(int i = 0; i < int(sections.size()); i++)
+    {
+        const Section &s = sections[i];
+        offset = (offset + 7) & ~7ULL;
+        offsets[i] = offset;
+        char *e = &table[header + entry * i];
+        strncpy(e, s.name.c_str(), 23);
+        e[24] = s.type;
+        memcpy(e + 32, &s.count, 8);
+        memcpy(e + 40, &offset, 8);
+        offset += s.bytes;
+    }
+    std::ofstream file(path.c_str(), std::ios::binary);
+    if(!file)
+        failed(path);
+    file.write(table.data(), table.size());
+    unsigned long long written = table.size();
+    for(int i = 0; i < int(sections.size()); i++)
+    {
+        static const char padding[8] = {0};
+        file.write(padding, offsets[i] - written);
+        file.write(sections[i].data, sections[i].bytes);
+        written = offsets[i] + sections[i].bytes;
+    }
+    file.close();
+    if(!file)
+        failed(path);
+}
+
+//Names of the given contigs as one pool of NUL terminated strings with offsets into it, and their
+//lengths.
+class ContigColumns
+{
+public:
+    ContigColumns(const ContigTable &contigs, const std::vector<int> &ids);
+    void add_to(ImageWriter &image) const;
+private:
+    std::vector<unsigned char> pool;
+    std::vector<long long> offsets;
+    std::vector<int> lengths;
+};
+
+inline ContigColumns :: ContigColumns(const ContigTable &contigs, const std::vector<int> &ids) : lengths(ids.size())
+{
+    for(int i = 0; i < int(ids.size()); i++)
+    {
+        offsets.push_back(pool.size());
+        const std::string &name = contigs.name(ids[i]);
+        pool.insert(pool.end(), name.begin(), name.end());
+        pool.push_back('\0');
+        lengths[i] = contigs.length(ids[i]);
+    }
+    offsets.push_back(pool.size());
+}
+
+inline void ContigColumns :: add_to(ImageWriter &image) const
+{
+    image.add("name_offsets", offsets);
+    image.add("names", pool);
+    image.add("length", lengths);
+}
+
+//Links column by column. contig_a and contig_b are translated through node when given.
+class LinkColumns
+{
+public:
+    LinkColumns(const LinkArray &links, const std::vector<int> *node = NULL);
+    void add_to(ImageWriter &image) const;
+private:
+    std::vector<int> contig_a, contig_b, bsize;
+    std::vector<unsigned char> end_a, end_b;
+    std::vector<double> mean, stdev;
+};
+
+inline LinkColumns :: LinkColumns(const LinkArray &links, const std::vector<int> *node)
+{
+    int n = links.size();
+    contig_a.resize(n);
+    contig_b.resize(n);
+    bsize.resize(n);
+    end_a.resize(n);
+    end_b.resize(n);
+    mean.resize(n);
+    stdev.resize(n);
+    for(int i = 0; i < n; i++)
+    {
+        contig_a[i] = node ? (*node)[links[i].contig_a] : links[i].contig_a;
+        contig_b[i] = node ? (*node)[links[i].contig_b] : links[i].contig_b;
+        end_a[i] = links[i].end_a;
+        end_b[i] = links[i].end_b;
+        mean[i] = links[i].mean;
+        stdev[i] = links[i].stdev;
+        bsize[i] = links[i].bundle_size;
+    }
+}
+
+inline void LinkColumns :: add_to(ImageWriter &image) const
+{
+    image.add("contig_a", contig_a);
+    image.add("contig_b", contig_b);
+    image.add("end_a", end_a);
+    image.add("end_b", end_b);
+    image.add("mean", mean);
+    image.add("stdev", stdev);
+    image.add("bsize", bsize);
+}
+
+inline void write_link_image(const std::string &path, const ContigTable &contigs, const LinkArray &links)
+{
+    ImageWriter image("links");
+    std::vector<int> all(contigs.size());
+    for(int c = 0; c < contigs.size(); c++)
+        all[c] = c;
+    ContigColumns contig_columns(contigs, all);
+    contig_columns.add_to(image);
+    LinkColumns link_columns(links);
+    link_columns.add_to(image);
+    LinkGraph graph(contigs.size(), links);
+    image.add("out_offsets", graph.out_offsets);
+    image.add("out_links", graph.out_links);
+    image.add("in_offsets", graph.in_offsets);
+    image.add("in_links", graph.in_links);
+    image.write(path);
+}
+
+#endif
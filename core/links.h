@@ -0,0 +1,225 @@
+#ifndef METACARVEL_LINKS_H
+#define METACARVEL_LINKS_H
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "contigs.h"
+
+//A link between two contig ends, either a single read pair (libcorrect) or a bundle of them.
+//end_a and end_b are 'B' or 'E'. bundle_size is the number of read pairs the link stands for, more
+//than 1 for an unbundled link when libcorrect capped the links of its contig pair.
+struct Link
+{
+    int contig_a;
+    int contig_b;
+    char end_a;
+    char end_b;
+    double mean;
+    double stdev;
+    int bundle_size;
+
+    bool has_orientation(const char *o) const
+    {
+        return end_a == o[0] && end_b == o[1];
+    }
+    std::string orientation() const
+    {
+        return std::string(1, end_a) + end_b;
+    }
+};
+
+typedef std::vector<Link> LinkArray;
+
+//Contig pair and orientation of a link, what links are grouped by for bundling and capping.
+struct LinkKey
+{
+    int contig_a;
+    int contig_b;
+    char end_a;
+    char end_b;
+
+    explicit LinkKey(const Link &l) : contig_a(l.contig_a), contig_b(l.contig_b), end_a(l.end_a), end_b(l.end_b) {}
+    bool operator==(const LinkKey &o) const
+    {
+        return contig_a == o.contig_a && contig_b == o.contig_b && end_a == o.end_a && end_b == o.end_b;
+    }
+    struct Hash
+    {
+        size_t operator()(const LinkKey &k) const
+        {
+            unsigned long long pair = ((unsigned long long)(unsigned int)k.contig_a << 32) | (unsigned int)k.contig_b;
+            return std::hash<unsigned long long>()(pair * 0x9e3779b97f4a7c15ULL ^ ((unsigned char)k.end_a << 8 | (unsigned char)k.end_b));
+        }
+    };
+};
+
+//Reads a link TSV. Unbundled files (contig_links) have 6 columns, bundled ones a 7th for the
+//bundle size. Unbundled links only have the 7th column when they stand for more than one read
+//pair. Reading stops at the first line that does not parse, as the tools always did.
+inline void read_links(std::istream &in, ContigTable &contigs, LinkArray &links, bool bundled)
+{
+    ScopedTimer timer("read links");
+    size_t before = links.size();
+    std::string line;
+    while(getline(in,line))
+    {
+        std::string a,b,c,d;
+        double e,f;
+        int g = 1;
+        std::istringstream iss(line);
+        if(!(iss >> a >> b >> c >> d >> e >> f))
+            break;
+        if(!(iss >> g))
+        {
+            if(bundled)
+                break;
+            g = 1;
+        }
+        Link l;
+        l.contig_a = contigs.intern(a);
+        l.end_a = b[0];
+        l.contig_b = contigs.intern(c);
+        l.end_b = d[0];
+        l.mean = e;
+        l.stdev = f;
+        l.bundle_size = g;
+        links.push_back(l);
+    }
+    Stats::get().count("links read", links.size() - before);
+}
+
+inline void read_links(const std::string &file, ContigTable &contigs, LinkArray &links, bool bundled)
+{
+    InputFile linkfile(file);
+    read_links(linkfile, contigs, links, bundled);
+    close_or_exit(linkfile);
+}
+
+inline void write_link(std::ostream &out, const ContigTable &contigs, const Link &l, bool bundled)
+{
+    out<<contigs.name(l.contig_a)<<"\t"<<l.end_a<<"\t"<<contigs.name(l.contig_b)<<"\t"<<l.end_b<<"\t"<<l.mean<<"\t"<<l.stdev;
+    if(bundled || l.bundle_size != 1)
+        out<<"\t"<<l.bundle_size;
+    out<<"\n";
+}
+
+inline void write_links(std::ostream &out, const ContigTable &contigs, const LinkArray &links, bool bundled)
+{
+    ScopedTimer timer("write links");
+    Stats::get().count("links written", links.size());
+    for(int i = 0; i < int(links.size()); i++)
+        write_link(out, contigs, links[i], bundled);
+}
+
+//CSR adjacency over contig ids. out_links lists the links leaving each contig (contig_a),
+//in_links the links entering it (contig_b), both in link order.
+class LinkGraph
+{
+public:
+    std::vector<int> out_offsets;
+    std::vector<int> out_links;
+    std::vector<int> in_offsets;
+    std::vector<int> in_links;
+
+    LinkGraph() {}
+    LinkGraph(int ncontigs, const LinkArray &links) { build(ncontigs, links); }
+    void build(int ncontigs, const LinkArray &links);
+    int out_degree(int c) const { return out_offsets[c+1] - out_offsets[c]; }
+    int in_degree(int c) const { return in_offsets[c+1] - in_offsets[c]; }
+};
+
+inline void LinkGraph :: build(int ncontigs, const LinkArray &links)
+{
+    out_offsets.assign(ncontigs + 1, 0);
+    in_offsets.assign(ncontigs + 1, 0);
+    for(int i = 0; i < int(links.size()); i++)
+    {
+        out_offsets[links[i].contig_a + 1]++;
+        in_offsets[links[i].contig_b + 1]++;
+    }
+    for(int c = 0; c < ncontigs; c++)
+    {
+        out_offsets[c+1] += out_offsets[c];
+        in_offsets[c+1] += in_offsets[c];
+    }
+    out_links.resize(links.size());
+    in_links.resize(links.size());
+    std::vector<int> out_fill(out_offsets.begin(), out_offsets.end() - 1);
+    std::vector<int> in_fill(in_offsets.begin(), in_offsets.end() - 1);
+    for(int i = 0; i < int(links.size()); i++)
+    {
+        out_links[out_fill[links[i].contig_a]++] = i;
+        in_links[in_fill[links[i].contig_b]++] = i;
+    }
+}
+
+//Strongly connected components by an iterative Tarjan, with DFS roots taken in the order of
+//roots. Returns the component of every contig, -1 for contigs without links, and fills postorder
+//with the contigs in DFS postorder. Components are numbered in the order they complete.
+inline std::vector<int> strong_components(const LinkArray &links, const LinkGraph &graph, const std::vector<int> &roots, std::vector<int> &postorder)
+{
+    int ncontigs = graph.out_offsets.size() - 1;
+    std::vector<int> component(ncontigs, -1), index(ncontigs, -1), lowlink(ncontigs, 0);
+    std::vector<bool> onstack(ncontigs, false);
+    std::vector<int> stack;
+    std::vector<std::pair<int,int> > calls;      //contig and next out link offset
+    postorder.clear();
+    int counter = 0, ncomponents = 0;
+    for(int r = 0; r < int(roots.size()); r++)
+    {
+        int root = roots[r];
+        if(index[root] != -1 || graph.out_degree(root) + graph.in_degree(root) == 0)
+            continue;
+        calls.push_back(std::make_pair(root, graph.out_offsets[root]));
+        index[root] = lowlink[root] = counter++;
+        stack.push_back(root);
+        onstack[root] = true;
+        while(!calls.empty())
+        {
+            int v = calls.back().first;
+            int &next = calls.back().second;
+            if(next < graph.out_offsets[v+1])
+            {
+                int w = links[graph.out_links[next++]].contig_b;
+                if(index[w] == -1)
+                {
+                    calls.push_back(std::make_pair(w, graph.out_offsets[w]));
+                    index[w] = lowlink[w] = counter++;
+                    stack.push_back(w);
+                    onstack[w] = true;
+                }
+                else if(onstack[w])
+                {
+                    lowlink[v] = std::min(lowlink[v], index[w]);
+                }
+                continue;
+            }
+            calls.pop_back();
+            postorder.push_back(v);
+            if(!calls.empty())
+                lowlink[calls.back().first] = std::min(lowlink[calls.back().first], lowlink[v]);
+            if(lowlink[v] == index[v])
+            {
+                int w;
+                do
+                {
+                    w = stack.back();
+                    stack.pop_back();
+                    onstack[w] = false;
+                    component[w] = ncomponents;
+                } while(w != v);
+                ncomponents++;
+            }
+        }
+    }
+    return component;
+}
+
+#endif
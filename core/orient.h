@@ -0,0 +1,702 @@
+#ifndef METACARVEL_ORIENT_H
+#define METACARVEL_ORIENT_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "contigs.h"
+#include "image.h"
+#include "links.h"
+#include "resources.h"
+
+//Greedy orientation of contigs over the bundled links (orientcontigs).
+
+const int FOW = 1, REV = 2, NIL = 0;
+
+class Orientation
+{
+public:
+    std::vector<int> orient;        //FOW/REV/NIL per contig id
+    std::vector<bool> placed;       //contig is a node of the oriented graph
+    std::vector<bool> invalid;      //per link, link disagrees with the orientation
+    std::vector<std::pair<int,int> > invalidated; //(contig, invalidated bundle size) per invalidation pass
+};
+
+class Node
+{
+public:
+    int contig;
+    int length;
+    int degree;
+    Node () {}
+    Node(int contig, int length) : contig(contig), length(length), degree(0) {}
+    Node(int contig, int length, int degree) : contig(contig), length(length), degree(degree) {}
+};
+
+//comparators for node class
+
+struct MoreThanByLength
+{
+    bool operator()(const Node& lhs, const Node& rhs) const
+    {
+        return lhs.length > rhs.length;
+    }
+};
+
+struct MoreThanByDegree
+{
+    bool operator()(const Node& lhs, const Node& rhs) const
+    {
+        return lhs.degree > rhs.degree;
+    }
+};
+
+class Orienter
+{
+private:
+    const LinkArray &links;
+    const ContigTable &contigs;
+    LinkGraph graph;
+    std::vector<int> contig2degree;
+    std::vector<int> order;
+    Orientation &result;
+
+    int get_degree(int contig) const;
+    int findorientation(int node_to_orient);
+    void invalidatelinks(int v, int orientation);
+    void sort_adjacency(int u, const std::string &strategy);
+    void visit(int u, std::vector<int> &pushed);
+    void bfs(int start, const std::string &strategy);
+    int get_unoriented_node_by_degree() const;
+public:
+    Orienter(const LinkArray &links, const ContigTable &contigs, Orientation &result);
+    void run(const std::string &strategy, bool start_by_degree);
+};
+
+inline Orienter :: Orienter(const LinkArray &links, const ContigTable &contigs, Orientation &result)
+    : links(links), contigs(contigs), graph(contigs.size(), links), result(result)
+{
+    result.orient.assign(contigs.size(), NIL);
+    result.placed.assign(contigs.size(), false);
+    result.invalid.assign(links.size(), false);
+    result.invalidated.clear();
+    for(int i = 0; i < int(links.size()); i++)
+    {
+        result.placed[links[i].contig_a] = true;
+        result.placed[links[i].contig_b] = true;
+    }
+    order = contigs.by_name();
+    contig2degree.assign(contigs.size(), 0);
+    for(int c = 0; c < contigs.size(); c++)
+        if(contigs.has_length(c))
+            contig2degree[c] = get_degree(c);
+}
+
+inline int Orienter :: get_degree(int contig) const
+{
+    return graph.out_degree(contig) + graph.in_degree(contig);
+}
+
+inline int Orienter :: findorientation(int node_to_orient)
+{
+    std::cerr<<"finding orientation for node "<<contigs.name(node_to_orient)<<std::endl;
+    int curr_fow = 0, curr_rev = 0;
+    for(int i = graph.out_offsets[node_to_orient]; i < graph.out_offsets[node_to_orient+1]; i++)
+    {
+        int id = graph.out_links[i];
+        const Link &link = links[id];
+        if(result.invalid[id])
+            continue;
+        int orientation = result.orient[link.contig_b];
+        if(orientation == FOW)
+        {
+            if(link.has_orientation("EB"))
+                curr_fow += link.bundle_size;
+            if(link.has_orientation("BB"))
+                curr_rev += link.bundle_size;
+        }
+        if(orientation == REV)
+        {
+            if(link.has_orientation("EE"))
+                curr_fow += link.bundle_size;
+            if(link.has_orientation("BE"))
+                curr_rev += link.bundle_size;
+        }
+    }
+    //check if any of the neighbors is oriented, if yes then use that to orient current node
+    for(int i = graph.in_offsets[node_to_orient]; i < graph.in_offsets[node_to_orient+1]; i++)
+    {
+        int id = graph.in_links[i];
+        const Link &link = links[id];
+        if(result.invalid[id])
+            continue;
+        int orientation = result.orient[link.contig_a];
+        if(orientation == FOW)
+        {
+            if(link.has_orientation("EB"))
+                curr_fow += link.bundle_size;
+            if(link.has_orientation("EE"))
+                curr_rev += link.bundle_size;
+        }
+        if(orientation == REV)
+        {
+            if(link.has_orientation("BB"))
+                curr_fow += link.bundle_size;
+            if(link.has_orientation("BE"))
+                curr_rev += link.bundle_size;
+        }
+    }
+    if(curr_fow >= curr_rev)
+        return FOW;
+    return REV;
+}
+
+//link orientation expected between two oriented contigs, source contig first
+inline const char *expected_orientation(int source, int target)
+{
+    if(source == FOW && target == FOW)
+        return "EB";
+    if(source == REV && target == REV)
+        return "BE";
+    if(source == FOW && target == REV)
+        return "EE";
+    return "BB";
+}
+
+inline void Orienter :: invalidatelinks(int v, int orientation)
+{
+    int count = 0;
+    std::cerr<<"invalidating..."<<contigs.name(v)<<std::endl;
+    for(int i = graph.out_offsets[v]; i < graph.out_offsets[v+1]; i++)
+    {
+        int id = graph.out_links[i];
+        const Link &link = links[id];
+        int neighorientation = result.orient[link.contig_b];
+        if(neighorientation != NIL && orientation != NIL && !link.has_orientation(expected_orientation(orientation, neighorientation)))
+        {
+            result.invalid[id] = true;
+            count += link.bundle_size;
+        }
+    }
+    for(int i = graph.in_offsets[v]; i < graph.in_offsets[v+1]; i++)
+    {
+        int id = graph.in_links[i];
+        const Link &link = links[id];
+        int neighorientation = result.orient[link.contig_a];
+        if(neighorientation != NIL && orientation != NIL && !link.has_orientation(expected_orientation(neighorientation, orientation)))
+        {
+            result.invalid[id] = true;
+            count += link.bundle_size;
+        }
+    }
+    result.invalidated.push_back(std::make_pair(v, count));
+}
+
+//adjacency of u is put in visiting order once, when u is taken out of the queue
+inline void Orienter :: sort_adjacency(int u, const std::string &strategy)
+{
+    std::vector<int> :: iterator first = graph.out_links.begin() + graph.out_offsets[u];
+    std::vector<int> :: iterator last = graph.out_links.begin() + graph.out_offsets[u+1];
+    const LinkArray &l = links;
+    const ContigTable &c = contigs;
+    const std::vector<int> &degree = contig2degree;
+    if(strategy == "length")
+        std::sort(first, last, [&l, &c](int lhs, int rhs) { return c.length(l[lhs].contig_b) > c.length(l[rhs].contig_b); });
+    else if(strategy == "degree")
+        std::sort(first, last, [&l, &degree](int lhs, int rhs) { return degree[l[lhs].contig_b] > degree[l[rhs].contig_b]; });
+    else
+        std::sort(first, last, [&l](int lhs, int rhs) { return l[lhs].bundle_size > l[rhs].bundle_size; });
+}
+
+//orients the unoriented neighbors of u and collects them in pushed
+inline void Orienter :: visit(int u, std::vector<int> &pushed)
+{
+    pushed.clear();
+    for(int i = graph.out_offsets[u]; i < graph.out_offsets[u+1]; i++)
+    {
+        int v = links[graph.out_links[i]].contig_b;
+        if(result.orient[v] == NIL)
+        {
+            int orientation = findorientation(v);
+            result.orient[v] = orientation;
+            invalidatelinks(v,orientation);
+            pushed.push_back(v);
+        }
+        else
+        {
+            invalidatelinks(v,result.orient[v]);
+        }
+    }
+}
+
+inline void Orienter :: bfs(int start, const std::string &strategy)
+{
+    std::vector<int> pushed;
+    //Priority Queue based BFS using length as priority
+    if(strategy == "length")
+    {
+        std :: priority_queue<Node,std::vector<Node>, MoreThanByLength> Q;
+        Q.push(Node(start,contigs.length(start)));
+        while(!Q.empty())
+        {
+            int u = Q.top().contig;
+            Q.pop();
+            sort_adjacency(u, strategy);
+            visit(u, pushed);
+            for(int i = 0; i < int(pushed.size()); i++)
+                Q.push(Node(pushed[i],contigs.length(pushed[i])));
+        }
+    }
+    //priority based BFS using degree as priority
+    if(strategy == "degree")
+    {
+        std :: priority_queue<Node,std::vector<Node>, MoreThanByDegree> Q;
+        Q.push(Node(start,contigs.length(start),get_degree(start)));
+        while(!Q.empty())
+        {
+            int u = Q.top().contig;
+            Q.pop();
+            sort_adjacency(u, strategy);
+            visit(u, pushed);
+            for(int i = 0; i < int(pushed.size()); i++)
+                Q.push(Node(pushed[i],contigs.length(pushed[i]),get_degree(pushed[i])));
+        }
+    }
+    //Choose node by bundle size
+    if(strategy == "bsize")
+    {
+        std::queue<int> Q;
+        Q.push(start);
+        while(!Q.empty())
+        {
+            int u = Q.front();
+            Q.pop();
+            sort_adjacency(u, strategy);
+            visit(u, pushed);
+            for(int i = 0; i < int(pushed.size()); i++)
+                Q.push(pushed[i]);
+        }
+    }
+}
+
+inline int Orienter :: get_unoriented_node_by_degree() const
+{
+    int max_degree = -1;
+    int max_contig = -1;
+    for(int i = 0; i < int(order.size()); i++)
+    {
+        int c = order[i];
+        if(result.placed[c] && result.orient[c] == NIL && get_degree(c) > max_degree)
+        {
+            max_degree = contigs.length(c);
+            max_contig = c;
+        }
+    }
+    return max_contig;
+}
+
+inline void Orienter :: run(const std::string &strategy, bool start_by_degree)
+{
+    //assign orientation to any node
+    int maxlength = -1;
+    int maxnode = -1;
+    for(int i = 0; i < int(order.size()); i++)
+    {
+        int c = order[i];
+        if(start_by_degree)
+        {
+            if(graph.out_degree(c) > 0 && graph.out_degree(c) > maxlength)
+            {
+                maxlength = graph.out_degree(c);
+                maxnode = c;
+            }
+        }
+        else if(contigs.has_length(c) && contigs.length(c) > maxlength)
+        {
+            maxlength = contigs.length(c);
+            maxnode = c;
+        }
+    }
+    if(maxnode != -1)
+    {
+        result.placed[maxnode] = true;
+        result.orient[maxnode] = FOW;
+        invalidatelinks(maxnode,FOW);
+        bfs(maxnode,strategy);
+    }
+
+    //unoriented contigs by decreasing length, ties broken by name
+    std::vector<int> by_length;
+    for(int i = 0; i < int(order.size()); i++)
+        if(result.placed[order[i]])
+            by_length.push_back(order[i]);
+    const ContigTable &c = contigs;
+    std::stable_sort(by_length.begin(), by_length.end(), [&c](int a, int b) { return c.length(a) > c.length(b); });
+    int next = 0;
+    while(true)
+    {
+        int nd = -1;
+        if(strategy == "bsize" || strategy == "length")
+        {
+            while(next < int(by_length.size()) && result.orient[by_length[next]] != NIL)
+                next++;
+            if(next < int(by_length.size()))
+                nd = by_length[next];
+        }
+        else
+        {
+            nd = get_unoriented_node_by_degree();
+        }
+        if(nd == -1)
+            break;
+        result.orient[nd] = FOW;
+        bfs(nd,strategy);
+    }
+}
+
+//Orientation by the leading eigenvector of a signed link matrix, as an alternative to the BFS.
+//With x = +1 for FOW and -1 for REV, a link from contig a to contig b holds for x_a = s_a and
+//x_b = s_b, s_a = +1 for end E of a and s_b = +1 for end B of b. Its bundle size w then adds
+//w (1 + s_a x_a + s_b x_b + s_a s_b x_a x_b) / 4 to the read pairs the orientation agrees with.
+//The s_a s_b term is the signed adjacency: + for links between contigs on the same strand (EB,
+//BE), - for opposite strands (EE, BB). The linear terms, which tell a contig pair from its
+//reverse complement, become edges to a ground node fixed at FOW. Relaxed to real x, the best
+//orientation is the leading eigenvector of D + A, A the signed adjacency with ground and D the
+//diagonal of absolute row weights. D + A is positive semidefinite, so power iteration finds it.
+//Each connected component is solved on its own, with the products over CSR rows split over
+//threads for large ones. The vector is rounded by sign, contigs are flipped one at a time while
+//that makes more read pairs agree, and the links that still disagree are invalidated. Unlike the
+//BFS the result does not depend on the order contigs are visited in.
+class SpectralOrienter
+{
+public:
+    static const int PARALLEL_ROWS = 1 << 14;
+    static const int MAX_ITERATIONS = 1000;
+    static const int MAX_SWEEPS = 100;
+    SpectralOrienter(const LinkArray &links, const ContigTable &contigs, Orientation &result);
+    void run();
+private:
+    const LinkArray &links;
+    const ContigTable &contigs;
+    LinkGraph graph;
+    Orientation &result;
+    long long iterations;
+    long long flips;
+
+    void orient_component(const std::vector<int> &nodes, std::vector<int> &local);
+    void power_iteration(const std::vector<int> &offsets, const std::vector<int> &targets, const std::vector<double> &weights, std::vector<double> &x);
+    int agreement(int v, int orientation) const;
+};
+
+inline SpectralOrienter :: SpectralOrienter(const LinkArray &links, const ContigTable &contigs, Orientation &result)
+    : links(links), contigs(contigs), graph(contigs.size(), links), result(result), iterations(0), flips(0)
+{
+    result.orient.assign(contigs.size(), NIL);
+    result.placed.assign(contigs.size(), false);
+    result.invalid.assign(links.size(), false);
+    result.invalidated.clear();
+    for(int i = 0; i < int(links.size()); i++)
+    {
+        result.placed[links[i].contig_a] = true;
+        result.placed[links[i].contig_b] = true;
+    }
+}
+
+//D + A times x, one CSR row after the other
+inline void SpectralOrienter :: power_iteration(const std::vector<int> &offsets, const std::vector<int> &targets, const std::vector<double> &weights, std::vector<double> &x)
+{
+    int n = x.size();
+    std::vector<double> diagonal(n, 0), y(n);
+    for(int u = 0; u < n; u++)
+        for(int i = offsets[u]; i < offsets[u+1]; i++)
+            diagonal[u] += std::fabs(weights[i]);
+    auto rows = [&](int first, int last) {
+        for(int u = first; u < last; u++)
+        {
+            double sum = diagonal[u] * x[u];
+            for(int i = offsets[u]; i < offsets[u+1]; i++)
+                sum += weights[i] * x[targets[i]];
+            y[u] = sum;
+        }
+    };
+    //the threads are started once per component, each takes the same slice of rows every iteration
+    int nchunks = (n + PARALLEL_ROWS - 1) / PARALLEL_ROWS;
+    ThreadTeam team(std::min(Resources::get().threads(), nchunks));
+    int nthreads = team.size();
+    for(int iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+    {
+        iterations++;
+        team.run([&](int t) { rows((long long)n * t / nthreads, (long long)n * (t + 1) / nthreads); });
+        double norm = 0;
+        for(int u = 0; u < n; u++)
+            norm += y[u] * y[u];
+        norm = std::sqrt(norm);
+        if(norm == 0)
+            return;
+        double change = 0;
+        for(int u = 0; u < n; u++)
+        {
+            y[u] /= norm;
+            change += (y[u] - x[u]) * (y[u] - x[u]);
+        }
+        x.swap(y);
+        if(change < 1e-18)
+            return;
+    }
+}
+
+//bundle sizes of the links of v that hold with v in orientation, given its neighbours
+inline int SpectralOrienter :: agreement(int v, int orientation) const
+{
+    int count = 0;
+    for(int i = graph.out_offsets[v]; i < graph.out_offsets[v+1]; i++)
+    {
+        const Link &link = links[graph.out_links[i]];
+        if(link.has_orientation(expected_orientation(orientation, result.orient[link.contig_b])))
+            count += link.bundle_size;
+    }
+    for(int i = graph.in_offsets[v]; i < graph.in_offsets[v+1]; i++)
+    {
+        const Link &link = links[graph.in_links[i]];
+        if(link.has_orientation(expected_orientation(result.orient[link.contig_a], orientation)))
+            count += link.bundle_size;
+    }
+    return count;
+}
+
+//nodes are the contigs of one component, local maps them to 0..n-1, the ground node is n
+inline void SpectralOrienter :: orient_component(const std::vector<int> &nodes, std::vector<int> &local)
+{
+    int n = nodes.size();
+    for(int u = 0; u < n; u++)
+        local[nodes[u]] = u;
+
+    //every link adds a_b, b_a, a_ground, ground_a, b_ground and ground_b entries
+    std::vector<int> offsets(n + 2, 0);
+    for(int u = 0; u < n; u++)
+    {
+        for(int i = graph.out_offsets[nodes[u]]; i < graph.out_offsets[nodes[u]+1]; i++)
+        {
+            const Link &link = links[graph.out_links[i]];
+            offsets[local[link.contig_a] + 1] += 2;
+            offsets[local[link.contig_b] + 1] += 2;
+            offsets[n + 1] += 2;
+        }
+    }
+    for(int u = 0; u <= n; u++)
+        offsets[u+1] += offsets[u];
+    std::vector<int> targets(offsets[n+1]), fill(offsets.begin(), offsets.end() - 1);
+    std::vector<double> weights(offsets[n+1]);
+    auto add = [&](int u, int v, double w) {
+        targets[fill[u]] = v;
+        weights[fill[u]++] = w;
+    };
+    for(int u = 0; u < n; u++)
+    {
+        for(int i = graph.out_offsets[nodes[u]]; i < graph.out_offsets[nodes[u]+1]; i++)
+        {
+            const Link &link = links[graph.out_links[i]];
+            int a = local[link.contig_a], b = local[link.contig_b];
+            double sa = (link.end_a == 'E') ? 1 : -1, sb = (link.end_b == 'B') ? 1 : -1;
+            double w = link.bundle_size;
+            add(a, b, sa * sb * w);
+            add(b, a, sa * sb * w);
+            add(a, n, sa * w);
+            add(n, a, sa * w);
+            add(b, n, sb * w);
+            add(n, b, sb * w);
+        }
+    }
+
+    //deterministic start away from any eigenvector of the graph structure
+    std::vector<double> x(n + 1);
+    for(int u = 0; u <= n; u++)
+        x[u] = 1 + ((u * 2654435761U) >> 16) / 65536.0;
+    power_iteration(offsets, targets, weights, x);
+    for(int u = 0; u < n; u++)
+        result.orient[nodes[u]] = (x[u] * x[n] >= 0) ? FOW : REV;
+
+    for(int sweep = 0; sweep < MAX_SWEEPS; sweep++)
+    {
+        bool changed = false;
+        for(int u = 0; u < n; u++)
+        {
+            int v = nodes[u];
+            int flipped = (result.orient[v] == FOW) ? REV : FOW;
+            if(agreement(v, flipped) > agreement(v, result.orient[v]))
+            {
+                result.orient[v] = flipped;
+                flips++;
+                changed = true;
+            }
+        }
+        if(!changed)
+            break;
+    }
+}
+
+inline void SpectralOrienter :: run()
+{
+    //components in name order of their first contig, contigs in BFS order from it
+    std::vector<int> order = contigs.by_name();
+    std::vector<int> local(contigs.size(), -1);
+    std::vector<bool> seen(contigs.size(), false);
+    long long ncomponents = 0;
+    for(int k = 0; k < int(order.size()); k++)
+    {
+        int start = order[k];
+        if(!result.placed[start] || seen[start])
+            continue;
+        std::vector<int> nodes(1, start);
+        seen[start] = true;
+        for(int j = 0; j < int(nodes.size()); j++)
+        {
+            int u = nodes[j];
+            for(int i = graph.out_offsets[u]; i < graph.out_offsets[u+1]; i++)
+            {
+                int v = links[graph.out_links[i]].contig_b;
+                if(!seen[v])
+                {
+                    seen[v] = true;
+                    nodes.push_back(v);
+                }
+            }
+            for(int i = graph.in_offsets[u]; i < graph.in_offsets[u+1]; i++)
+            {
+                int v = links[graph.in_links[i]].contig_a;
+                if(!seen[v])
+                {
+                    seen[v] = true;
+                    nodes.push_back(v);
+                }
+            }
+        }
+        orient_component(nodes, local);
+        ncomponents++;
+    }
+
+    for(int i = 0; i < int(links.size()); i++)
+        result.invalid[i] = !links[i].has_orientation(expected_orientation(result.orient[links[i].contig_a], result.orient[links[i].contig_b]));
+    std::vector<int> counts(contigs.size(), 0);
+    for(int i = 0; i < int(links.size()); i++)
+    {
+        if(!result.invalid[i])
+            continue;
+        counts[links[i].contig_a] += links[i].bundle_size;
+        counts[links[i].contig_b] += links[i].bundle_size;
+    }
+    for(int k = 0; k < int(order.size()); k++)
+        if(result.placed[order[k]])
+            result.invalidated.push_back(std::make_pair(order[k], counts[order[k]]));
+    Stats::get().count("spectral components", ncomponents);
+    Stats::get().count("power iterations", iterations);
+    Stats::get().count("refinement flips", flips);
+}
+
+//Orients the contigs of links. strategy is one of "bsize", "length" and "degree" for the greedy
+//BFS, or "spectral" for SpectralOrienter. The first contig of the BFS is the one with most
+//outgoing links when start_by_degree is set, the longest contig otherwise.
+inline void orient_contigs(const LinkArray &links, const ContigTable &contigs, const std::string &strategy, bool start_by_degree, Orientation &result)
+{
+    ScopedTimer timer("orient");
+    if(strategy == "spectral")
+    {
+        SpectralOrienter orienter(links, contigs, result);
+        orienter.run();
+    }
+    else
+    {
+        Orienter orienter(links, contigs, result);
+        orienter.run(strategy, start_by_degree);
+    }
+    if(Stats::get().enabled())
+        Stats::get().count("invalidated links", std::count(result.invalid.begin(), result.invalid.end(), true));
+}
+
+inline LinkArray valid_links(const LinkArray &links, const Orientation &result)
+{
+    LinkArray ret;
+    for(int i = 0; i < int(links.size()); i++)
+        if(!result.invalid[i])
+            ret.push_back(links[i]);
+    return ret;
+}
+
+inline void write_invalidated_counts(std::ostream &out, const ContigTable &contigs, const Orientation &result)
+{
+    for(int i = 0; i < int(result.invalidated.size()); i++)
+        out<<contigs.name(result.invalidated[i].first)<<"\t"<<result.invalidated[i].second<<"\n";
+}
+
+inline void write_oriented_graph(std::ostream &ofile, const ContigTable &contigs, const LinkArray &links, const Orientation &result)
+{
+    ScopedTimer timer("write oriented graph");
+    std::vector<int> contig2node(contigs.size(), 0);
+    std::vector<int> order = contigs.by_name();
+    int nodecounter = 1;
+    ofile << "graph ["<<"\n";
+    ofile << "  directed 1"<<"\n";
+    for(int i = 0; i < int(order.size()); i++)
+    {
+        int contig = order[i];
+        if(!result.placed[contig])
+            continue;
+        std::string o = (result.orient[contig] == FOW)?"FOW":"REV";
+        ofile<< "  node ["<<"\n";
+        ofile<< "   id "<<nodecounter<<"\n";
+        ofile<< "   label \"" <<contigs.name(contig)<<"\""<<"\n";
+        ofile<< "   orientation \""<<o<<"\""<<"\n";
+        ofile<< "   length \""<<contigs.length(contig)<<"\""<<"\n";
+        ofile<< "  ]"<<"\n";
+        contig2node[contig] = nodecounter;
+        nodecounter++;
+    }
+    for(int i = 0; i < int(links.size()); i++)
+    {
+        if(result.invalid[i])
+            continue;
+        const Link &link = links[i];
+        ofile<<"  edge ["<<"\n";
+        ofile<<"   source "<<contig2node[link.contig_a]<<"\n";
+        ofile<<"   target "<<contig2node[link.contig_b]<<"\n";
+        ofile<<"   orientation \""<<link.orientation()<<"\""<<"\n";
+        ofile<<"   mean \""<<link.mean<<"\""<<"\n";
+        ofile<<"   stdev "<<link.stdev<<"\n";
+        ofile<<"   bsize "<<link.bundle_size<<"\n";
+        ofile<<"  ]"<<"\n";
+    }
+    ofile<<"]"<<"\n";
+}
+
+//Binary snapshot of the oriented graph (kind "oriented"), holding what oriented.gml holds: the
+//placed contigs in the same order with their lengths and orientations, and the valid links, whose
+//contig_a and contig_b index that contig table.
+inline void write_oriented_image(const std::string &path, const ContigTable &contigs, const LinkArray &links, const Orientation &result)
+{
+    std::vector<int> nodes;
+    std::vector<int> node(contigs.size(), -1);
+    std::vector<unsigned char> orient;
+    std::vector<int> order = contigs.by_name();
+    for(int i = 0; i < int(order.size()); i++)
+    {
+        if(!result.placed[order[i]])
+            continue;
+        node[order[i]] = nodes.size();
+        nodes.push_back(order[i]);
+        orient.push_back(result.orient[order[i]]);
+    }
+    ImageWriter image("oriented");
+    ContigColumns contig_columns(contigs, nodes);
+    contig_columns.add_to(image);
+    image.add("orient", orient);
+    LinkColumns link_columns(valid_links(links, result), &node);
+    link_columns.add_to(image);
+    image.write(path);
+}
+
+#endif
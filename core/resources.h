@@ -0,0 +1,269 @@
+#ifndef METACARVEL_RESOURCES_H
+#define METACARVEL_RESOURCES_H
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+//Threads and memory a tool may use, set from --threads and --max-memory. Without --threads the
+//tools use the CPUs they are allowed to run on: the affinity mask, further limited by the cgroup
+//CPU quota of a container or batch job, neither of which std::thread::hardware_concurrency sees.
+//Without --max-memory the budget is the cgroup memory limit, if there is one. Stages whose data
+//would not fit the budget switch to a spilling mode instead of being OOM killed.
+
+//first line of a file under /sys/fs/cgroup, empty if it does not exist
+inline std::string cgroup_value(const std::string &file)
+{
+    std::ifstream in(file.c_str());
+    std::string line;
+    getline(in, line);
+    return line;
+}
+
+//path of this process in the unified (v2) hierarchy, from /proc/self/cgroup
+inline std::string cgroup_path()
+{
+    std::ifstream in("/proc/self/cgroup");
+    std::string line;
+    while(getline(in, line))
+        if(line.compare(0, 3, "0::") == 0)
+            return line.substr(3);
+    return "";
+}
+
+//CPUs allowed by the cgroup quota, rounded up, or 0 without a quota
+inline int cgroup_cpu_limit()
+{
+    long long quota = -1, period = 0;
+    std::string v2 = cgroup_value("/sys/fs/cgroup" + cgroup_path() + "/cpu.max");
+    if(v2 == "")
+        v2 = cgroup_value("/sys/fs/cgroup/cpu.max");
+    if(v2 != "")
+    {
+        std::istringstream iss(v2);
+        std::string q;
+        iss >> q >> period;
+        if(q != "max")
+            quota = atoll(q.c_str());
+    }
+    else
+    {
+        std::string q = cgroup_value("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+        std::string p = cgroup_value("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+        if(q != "" && p != "")
+        {
+            quota = atoll(q.c_str());
+            period = atoll(p.c_str());
+        }
+    }
+    if(quota <= 0 || period <= 0)
+        return 0;
+    return int((quota + period - 1) / period);
+}
+
+//cgroup memory limit in bytes, or 0 without one
+inline unsigned long long cgroup_memory_limit()
+{
+    std::string limit = cgroup_value("/sys/fs/cgroup" + cgroup_path() + "/memory.max");
+    if(limit == "")
+        limit = cgroup_value("/sys/fs/cgroup/memory.max");
+    if(limit == "")
+        limit = cgroup_value("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+    if(limit == "" || limit == "max")
+        return 0;
+    unsigned long long bytes = strtoull(limit.c_str(), NULL, 10);
+    //cgroup v1 reports "no limit" as a number close to 2^63
+    if(bytes >= (1ULL << 60))
+        return 0;
+    return bytes;
+}
+
+inline int available_cpus()
+{
+    int cpus = std::thread::hardware_concurrency();
+#ifdef __linux__
+    cpu_set_t set;
+    if(sched_getaffinity(0, sizeof(set), &set) == 0)
+        cpus = CPU_COUNT(&set);
+#endif
+    int limit = cgroup_cpu_limit();
+    if(limit > 0)
+        cpus = std::min(cpus, limit);
+    return std::max(cpus, 1);
+}
+
+//"4096", "512K", "800M", "16G" or "1T" in bytes. Returns false for anything else.
+inline bool parse_size(const std::string &text, unsigned long long &bytes)
+{
+    char *end;
+    double value = strtod(text.c_str(), &end);
+    if(end == text.c_str() || value < 0)
+        return false;
+    std::string unit(end);
+    if(unit.size() > 1 && (unit[unit.size()-1] == 'B' || unit[unit.size()-1] == 'b'))
+        unit.erase(unit.size()-1);
+    const std::string units = "KMGT";
+    double scale = 1;
+    if(unit.size() == 1)
+    {
+        size_t u = units.find(toupper(unit[0]));
+        if(u == std::string::npos)
+            return false;
+        for(size_t i = 0; i <= u; i++)
+            scale *= 1024;
+    }
+    else if(unit.size() > 1)
+    {
+        return false;
+    }
+    bytes = (unsigned long long)(value * scale);
+    return true;
+}
+
+class Resources
+{
+public:
+    static Resources &get();
+    int threads() const { return nthreads; }
+    unsigned long long memory() const { return budget; }
+    bool fits(unsigned long long bytes) const { return budget == 0 || bytes <= budget; }
+    bool set(int threads, const std::string &memory);
+private:
+    Resources() : nthreads(1), budget(0) {}
+    int nthreads;
+    unsigned long long budget;
+};
+
+inline Resources &Resources :: get()
+{
+    static Resources resources;
+    return resources;
+}
+
+//threads <= 0 means all available CPUs, an empty memory the cgroup limit
+inline bool Resources :: set(int threads, const std::string &memory)
+{
+    nthreads = threads > 0 ? threads : available_cpus();
+    if(memory == "")
+    {
+        budget = cgroup_memory_limit();
+        return true;
+    }
+    return parse_size(memory, budget);
+}
+
+//Calls f(i) for i in [0,n) on up to Resources::threads() threads. Indices are handed out one at a
+//time, so f has to write its result to a slot of its own for the output to stay in order.
+template<class F> inline void parallel_for(int n, F f)
+{
+    int nthreads = std::min(Resources::get().threads(), n);
+    if(nthreads <= 1)
+    {
+        for(int i = 0; i < n; i++)
+            f(i);
+        return;
+    }
+    std::atomic<int> next(0);
+    std::vector<std::thread> workers;
+    for(int t = 0; t < nthreads; t++)
+    {
+        workers.push_back(std::thread([&]() {
+            for(int i = next++; i < n; i = next++)
+                f(i);
+        }));
+    }
+    for(int t = 0; t < nthreads; t++)
+        workers[t].join();
+}
+
+//Threads kept for a loop that hands the same work out many times over, where starting threads on
+//every round would cost more than the work. run(f) calls f(t) for t in [0, size()) with the calling
+//thread taking t = 0, and returns when all of them are done.
+class ThreadTeam
+{
+public:
+    explicit ThreadTeam(int nthreads);
+    ~ThreadTeam();
+    int size() const { return nthreads; }
+    void run(const std::function<void(int)> &f);
+private:
+    void work(int t);
+    int nthreads;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable started, finished;
+    std::function<void(int)> task;
+    long long round;
+    int pending;
+    bool stopping;
+};
+
+inline ThreadTeam :: ThreadTeam(int nthreads) : nthreads(std::max(1, nthreads)), round(0), pending(0), stopping(false)
+{
+    for(int t = 1; t < this->nthreads; t++)
+        workers.push_back(std::thread(&ThreadTeam::work, this, t));
+}
+
+inline ThreadTeam :: ~ThreadTeam()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    started.notify_all();
+    for(int t = 0; t < int(workers.size()); t++)
+        workers[t].join();
+}
+
+inline void ThreadTeam :: work(int t)
+{
+    long long done = 0;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            started.wait(lock, [&]() { return stopping || round != done; });
+            if(stopping)
+                return;
+            done = round;
+        }
+        task(t);
+        std::lock_guard<std::mutex> lock(mutex);
+        if(--pending == 0)
+            finished.notify_one();
+    }
+}
+
+inline void ThreadTeam :: run(const std::function<void(int)> &f)
+{
+    if(nthreads == 1)
+    {
+        f(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = f;
+        pending = nthreads - 1;
+        round++;
+    }
+    started.notify_all();
+    f(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&]() { return pending == 0; });
+}
+
+#endif
@@ -0,0 +1,421 @@
+#ifndef METACARVEL_SEPPAIRS_H
+#define METACARVEL_SEPPAIRS_H
+
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <ogdf/basic/Graph.h>
+#include <ogdf/basic/simple_graph_alg.h>
+#include <ogdf/decomposition/BCTree.h>
+#include <ogdf/basic/GraphCopy.h>
+#include <ogdf/decomposition/StaticSPQRTree.h>
+#include <ogdf/decomposition/Skeleton.h>
+#include <ogdf/basic/Timeouter.h>
+
+#include "contigs.h"
+#include "links.h"
+#include "stats.h"
+
+//Separation pairs of the oriented graph from BC and SPQR trees (spqr).
+
+//Per bicomponent budgets (spqr --max_component_edges, --max_component_seconds), 0 for none. A
+//bicomponent with more links than the size budget is neither copied nor decomposed, as the SPQR
+//tree cannot be stopped once started. The time budget runs from the start of the decomposition
+//and is checked while the skeletons are turned into pairs, where an S-node of k contigs alone
+//yields up to k^2/2 of them. A bicomponent over either budget is reported on stderr and only the
+//pair of cut vertices found from the BC-tree is written for it, the rest of the graph goes on as
+//usual. Writing the pairs of a bicomponent within budget is not timed, each line lists all its
+//contigs, so the size budget is what bounds that output.
+class ComponentBudget : public ogdf::Timeouter
+{
+public:
+    ComponentBudget(int max_edges = 0, double seconds = 0)
+        : ogdf::Timeouter(seconds > 0 ? seconds : -1.0), max_edges(max_edges) {}
+    bool too_large(int edges) const { return max_edges > 0 && edges > max_edges; }
+    void start() { begin = std::chrono::steady_clock::now(); }
+    bool expired() const
+    {
+        return isTimeLimit() && std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count() > m_timeLimit;
+    }
+private:
+    int max_edges;
+    std::chrono::steady_clock::time_point begin;
+};
+
+class Bicomponent {
+	private:
+	  std::set<int> memberNodes;
+
+  public:
+    Bicomponent(std::set<int> mn) {
+      memberNodes = mn;
+    } //constructor
+};
+
+inline std::string getTypeString(ogdf::node &n, ogdf::StaticSPQRTree &s) {
+	std::string res = "unkown";
+	int type = s.typeOf(n);
+	switch (type) {
+		case 0:
+			res = "S";
+			break;
+		case 1:
+			res = "P";
+			break;
+		case 2:
+			res = "R";
+			break;
+	}
+	return res;
+}
+
+//cutVertex() gives vertices of the auxiliary graph, mapped straight back to the original graph
+inline void getCutVertexPair(ogdf::node bcTreeNode, ogdf::BCTree &bc, std::vector<std::pair<int,int> > &pairs)
+{
+  using namespace ogdf;
+  node n1,n2;
+  edge in1,in2,out1,out2;
+  if (bc.typeOfBNode(bcTreeNode) != 0) // Check if we're dealing with B-node
+    return ;
+
+  const Graph &bcT = bc.bcTree();       // the BT-Tree
+  List<edge> incoming, outgoing;        // Edge lists
+  bcT.inEdges(bcTreeNode, incoming);    // Get all incoming edges into BCTreeNode
+  bcT.outEdges(bcTreeNode, outgoing);   // Get all outgoing edges out of BCTreeNode
+
+  if (incoming.size() + outgoing.size() == 2) {
+    if (incoming.size() == 2){
+      in1 = incoming.front();
+      in2 = incoming.back();
+      n1  = bc.cutVertex(in1->source(),in1->source());
+      n2  = bc.cutVertex(in2->source(),in2->source());
+    }
+    else if (outgoing.size() == 2) {
+      out1 = outgoing.front();
+      out2 = outgoing.back();
+      n1 = bc.cutVertex(out1->target(),out1->target());
+      n2 = bc.cutVertex(out2->target(),out2->target());
+    }
+    else {
+      out1 = outgoing.front();
+      in1  = incoming.front();
+      n1 = bc.cutVertex(out1->target(),out1->target());
+      n2 = bc.cutVertex(in1->source(),in1->source());
+    }
+
+    if (n1 && n2) {
+      n1 =  bc.original(n1);
+      n2 =  bc.original(n2);
+     pairs.push_back(std::make_pair(n1->index(), n2->index()));
+    }
+  }
+}
+
+struct pair_hash {
+    template <class T1, class T2>
+    std::size_t operator () (const std::pair<T1,T2> &p) const {
+        auto h1 = std::hash<T1>{}(p.first);
+        auto h2 = std::hash<T2>{}(p.second);
+
+        // Mainly for demonstration purposes, i.e. works but is overly simple
+        // In the real world, use sth. like boost.hash_combine
+        return h1 ^ h2;
+    }
+};
+
+//Returns false if the budget ran out before all pairs were found.
+inline bool findTwoVertexCuts(ogdf::Skeleton &sk, std::unordered_map<int,int> &sk2orig, const std::string &type, std::vector<std::pair<int,int> > &pairs, const ComponentBudget &budget)
+{
+	using namespace ogdf;
+	const Graph &G = sk.getGraph();
+	int virtualCount;
+	edge e;
+
+	node n1;
+	const int nrNodes = G.numberOfNodes();
+	std::vector<int> allnodes(nrNodes);
+	int count = 0;
+
+	forall_nodes(n1, G) {
+		allnodes[count] = sk2orig[n1->index()];
+		count++;
+	}
+	if (type == "R") {
+		//A virtual edge in an R node represents a two vertex cut
+		forall_edges(e,G) {
+			if (sk.isVirtual(e))
+				pairs.push_back(std::make_pair(sk2orig[e->source()->index()], sk2orig[e->target()->index()]));
+		} //forall edges
+	}//if
+	else if (type == "P") {
+		//Node associated with p-nodes with two or more virtual edges are 2-vertex cuts
+		virtualCount = 0;
+		forall_edges(e,G) {
+			if (sk.isVirtual(e)) {
+				virtualCount++;
+				if (virtualCount > 1) {
+					pairs.push_back(std::make_pair(sk2orig[e->source()->index()], sk2orig[e->target()->index()]));
+					break;
+				}//if
+			}//if
+		}//forall_edges
+	}//else if
+	else if (type == "S")
+	{
+		// A virtual edge in an S node represents a 2-vertex cuts
+		std::unordered_map<std::pair<int,int>, bool, pair_hash > adjacent;
+		forall_edges(e,G) {
+			if (sk.isVirtual(e))
+				pairs.push_back(std::make_pair(sk2orig[e->source()->index()], sk2orig[e->target()->index()]));
+			else
+				adjacent[std::make_pair(sk2orig[e->source()->index()], sk2orig[e->target()->index()])] = true;
+			adjacent[std::make_pair(sk2orig[e->target()->index()], sk2orig[e->source()->index()])] = true;
+		} //forall edges
+
+
+		// All non-adjacent nodes in an S-node are cut-vertices
+		for (int i = 0; i < nrNodes-1; i++)
+		{
+				if (budget.expired())
+					return false;
+				for(int j = i+1; j < nrNodes; j++)
+						if(adjacent.find(std::make_pair(allnodes[i], allnodes[j])) == adjacent.end() or adjacent.find(std::make_pair(allnodes[j], allnodes[i])) == adjacent.end())
+							pairs.push_back(std::make_pair(allnodes[i], allnodes[j]));
+		}
+	}//else if
+	return true;
+} //getTwoVertexCuts
+
+inline std::set<int> getBiComponent(ogdf::GraphCopy *GC, ogdf::BCTree *p_bct, ogdf::node bcTreeNode)
+{
+	using namespace ogdf;
+	node n;
+	edge e;
+	std::set<int> memberNodes; // Members of the N-node
+
+	const Graph &auxGraph = p_bct->auxiliaryGraph();
+	EdgeArray<bool> inComponent(auxGraph, false);        //edges in component bcTreeNode
+	for(edge h : p_bct->hEdges(bcTreeNode))
+		inComponent[h] = true;
+	forall_edges (e, auxGraph) {							 						   //Check if edge belongs to component
+		if (!inComponent[e]) {			         //If not, delete edge from copy
+			GC->delEdge(GC->copy(e));
+		}
+	}
+	forall_nodes(n, auxGraph)
+	{								               //Delete nodes without edges
+		if (!GC->copy(n)->degree())
+		{
+			GC->delNode(GC->copy(n));
+		} //if
+		else
+		{
+		  int index = p_bct->original(n)->index();
+		  memberNodes.insert(index);
+		} //else
+	}// forall_nodes
+	return memberNodes;
+}
+
+//Members of a bicomponent read from its edges in the auxiliary graph, without copying it. Returns
+//false if the bicomponent has a loop.
+inline bool getBiComponentMembers(ogdf::BCTree *p_bct, ogdf::node bcTreeNode, std::set<int> &memberNodes)
+{
+	using namespace ogdf;
+	memberNodes.clear();
+	bool loopfree = true;
+	for(edge e : p_bct->hEdges(bcTreeNode))
+	{
+		loopfree = loopfree && !e->isSelfLoop();
+		memberNodes.insert(p_bct->original(e->source())->index());
+		memberNodes.insert(p_bct->original(e->target())->index());
+	}
+	return loopfree;
+}
+
+inline void write_pairs(std::ostream &ofile, const ContigTable &contigs, const std::vector<int> &node_contig, const std::vector<std::pair<int,int> > &pairs, const std::set<int> &memberNodes)
+{
+	ScopedTimer write("write pairs");
+	Stats::get().count("separation pairs", pairs.size());
+	for(int i = 0;i < int(pairs.size());i++)
+	{
+		ofile<<contigs.name(node_contig[pairs[i].first])<<"\t"<<contigs.name(node_contig[pairs[i].second]);
+		for(std::set<int> :: const_iterator it = memberNodes.begin(); it != memberNodes.end();++it)
+		{
+			ofile<<"\t"<<contigs.name(node_contig[*it]);
+		}
+		ofile<<"\n";
+	}
+}
+
+inline ogdf::node original(ogdf::node &n, ogdf::BCTree &bc, const ogdf::GraphCopy &GC, ogdf::Skeleton &sk)
+{
+	ogdf::node np;
+	np = bc.original(GC.original(sk.original(n)));
+	return np;
+}
+
+//Builds the link graph, nodes numbered from 1 in order of first appearance. node_contig maps
+//a node index back to its contig id. The graph is only traversed afterwards, so its nodes and
+//edges are laid out in index order in one arena (Graph::reserveContiguous).
+inline void build_link_graph(const LinkArray &links, ogdf::Graph &G, std::vector<int> &node_contig)
+{
+	std::unordered_map<int, int> contig_index;
+	node_contig.assign(1, -1);
+	for(int i = 0; i < int(links.size()); i++)
+	{
+		int ends[2] = {links[i].contig_a, links[i].contig_b};
+		for(int k = 0; k < 2; k++)
+		{
+			if(contig_index.find(ends[k]) == contig_index.end())
+			{
+				contig_index[ends[k]] = node_contig.size();
+				node_contig.push_back(ends[k]);
+			}
+		}
+	}
+	G.reserveContiguous(node_contig.size(), links.size());
+	std::vector<ogdf::node> nodes(node_contig.size(), nullptr);
+	for(int i = 1; i < int(node_contig.size()); i++)
+		nodes[i] = G.newNode(i);
+	for(int i = 0; i < int(links.size()); i++)
+		G.newEdge(nodes[contig_index[links[i].contig_a]], nodes[contig_index[links[i].contig_b]]);
+}
+
+//Writes one line per separation pair: the pair followed by all contigs of its bicomponent.
+inline void find_separation_pairs(const LinkArray &links, const ContigTable &contigs, std::ostream &ofile, ComponentBudget budget = ComponentBudget())
+{
+	using namespace ogdf;
+	ScopedTimer build("build graph");
+	Graph G;
+	std::vector<int> node_contig;
+	build_link_graph(links, G, node_contig);
+
+	//decompose into connected components
+	int nrCC = 0;
+	NodeArray<int> node2cc(G);
+	nrCC = connectedComponents(G, node2cc);
+
+	std::vector<node> startNodes(nrCC);
+	int index = 0;
+	node n;
+	forall_nodes(n, G)
+	{
+		if (index == nrCC)
+			break;
+		if (node2cc[n] == index)
+		{
+			startNodes[index] = n;
+			index++;
+		}
+	}
+	build.stop();
+	Stats::get().count("components", nrCC);
+	std::set<int> memberNodes;
+	std::unordered_map<int,int> sk2orig; // node mapping
+	std::vector<std::pair<int,int> > pairs;
+	//Building BC tree for each component
+	for(int j = 0;j < nrCC; j++)
+	{
+		ScopedTimer bctree("BC-tree");
+		BCTree bc(G,startNodes[j]);
+		BCTree *p_bct = &bc;
+		bctree.stop();
+
+		if(bc.numberOfBComps() == 0)
+		{
+			continue;
+		}
+		//Now, for each Biconnected Component, build SPQR tree
+		//Connected Components in auxgraph are the biconnected components of original graph
+		node bcTreeNode;
+		forall_nodes(bcTreeNode,bc.bcTree())
+		{
+			if(bc.typeOfBNode(bcTreeNode) == 0)
+			{
+				//a bicomponent over the size budget is not even copied
+				int componentEdges = p_bct->hEdges(bcTreeNode).size();
+				if(budget.too_large(componentEdges))
+				{
+					if(!getBiComponentMembers(p_bct, bcTreeNode, memberNodes) || componentEdges <= 2)
+					{
+						continue;
+					}
+					Stats::get().count("bicomponents", 1);
+					getCutVertexPair(bcTreeNode,bc,pairs);
+					std::cerr<<"bicomponent of "<<memberNodes.size()<<" contigs and "<<componentEdges<<" links over the size budget, writing only its cut vertex pair"<<std::endl;
+					Stats::get().count("bicomponents over budget", 1);
+					write_pairs(ofile, contigs, node_contig, pairs, memberNodes);
+					pairs.clear();
+					continue;
+				}
+				ScopedTimer copy("bicomponent copy");
+				GraphCopy GC(p_bct->auxiliaryGraph());
+				memberNodes = getBiComponent(&GC,p_bct,bcTreeNode);
+				//Now Generate SPQR tree for this component
+
+				bool biconnected = isBiconnected(GC);
+		        int  nrEdges     = GC.numberOfEdges();
+		        bool loopfree    = isLoopFree(GC);
+		        if(!biconnected || nrEdges <= 2 || !loopfree)
+		        {
+		        	continue;
+		        }
+		        copy.stop();
+		        Stats::get().count("bicomponents", 1);
+		        ScopedTimer cuts("cuts");
+		        getCutVertexPair(bcTreeNode,bc,pairs);
+		        cuts.stop();
+				budget.start();
+				size_t cut_pairs = pairs.size();
+				ScopedTimer tree("SPQR");
+				StaticSPQRTree spqr(GC);
+				tree.stop();
+				ScopedTimer skeletons("cuts");
+				const Graph &T = spqr.tree();
+				node Nn,cn;
+				bool complete = true;
+				forall_nodes(n, T)
+				{
+					if(budget.expired())
+					{
+						complete = false;
+						break;
+					}
+					const Graph &Gn = spqr.skeleton(n).getGraph();
+
+					// Generate hash table: sk2orig[Skeleton node] = Original node
+					forall_nodes(Nn, Gn)
+					{
+						cn = original(Nn,bc,GC,spqr.skeleton(n)); //Node in original graph G
+						sk2orig[Nn->index()] = cn->index();
+					}
+
+					std::string type = getTypeString(n, spqr);
+					//Get 2-vertex cuts
+					if(!findTwoVertexCuts(spqr.skeleton(n), sk2orig, type, pairs, budget))
+					{
+						complete = false;
+						break;
+					}
+				}
+				skeletons.stop();
+				if(!complete)
+				{
+					std::cerr<<"bicomponent of "<<memberNodes.size()<<" contigs and "<<nrEdges<<" links over the time budget, writing only its cut vertex pair"<<std::endl;
+					Stats::get().count("bicomponents over budget", 1);
+					pairs.resize(cut_pairs);
+				}
+				write_pairs(ofile, contigs, node_contig, pairs, memberNodes);
+				pairs.clear();
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef METACARVEL_STATS_H
+#define METACARVEL_STATS_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Phase timers and counters behind --stats. Nothing is recorded until enable() is called, so a
+//disabled timer costs one flag test. Phases and counters are reported in the order they were
+//first used, time spent in a phase several times (once per component, say) adds up.
+
+class Stats
+{
+public:
+    static Stats &get();
+    bool enabled() const { return on; }
+    void enable() { on = true; }
+    void add_time(const char *phase, double seconds);
+    void count(const char *name, long long n);
+    void write(std::ostream &out) const;
+private:
+    Stats() : on(false) {}
+    bool on;
+    std::vector<std::pair<std::string,double> > phases;
+    std::vector<std::pair<std::string,long long> > counters;
+};
+
+inline Stats &Stats :: get()
+{
+    static Stats stats;
+    return stats;
+}
+
+inline void Stats :: add_time(const char *phase, double seconds)
+{
+    for(int i = 0; i < int(phases.size()); i++)
+    {
+        if(phases[i].first == phase)
+        {
+            phases[i].second += seconds;
+            return;
+        }
+    }
+    phases.push_back(std::make_pair(std::string(phase), seconds));
+}
+
+inline void Stats :: count(const char *name, long long n)
+{
+    if(!on)
+        return;
+    for(int i = 0; i < int(counters.size()); i++)
+    {
+        if(counters[i].first == name)
+        {
+            counters[i].second += n;
+            return;
+        }
+    }
+    counters.push_back(std::make_pair(std::string(name), n));
+}
+
+inline void Stats :: write(std::ostream &out) const
+{
+    if(!on)
+        return;
+    double total = 0;
+    for(int i = 0; i < int(phases.size()); i++)
+    {
+        out<<"phase\t"<<phases[i].first<<"\t"<<phases[i].second<<"\n";
+        total += phases[i].second;
+    }
+    out<<"phase\ttotal\t"<<total<<"\n";
+    for(int i = 0; i < int(counters.size()); i++)
+        out<<"count\t"<<counters[i].first<<"\t"<<counters[i].second<<"\n";
+}
+
+//Adds the wall time from construction to stop() or the end of the scope to a phase.
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(const char *phase);
+    ~ScopedTimer() { stop(); }
+    void stop();
+private:
+    const char *phase;
+    bool running;
+    std::chrono::steady_clock::time_point start;
+};
+
+inline ScopedTimer :: ScopedTimer(const char *phase)
+{
+    this->phase = phase;
+    running = Stats::get().enabled();
+    if(running)
+        start = std::chrono::steady_clock::now();
+}
+
+inline void ScopedTimer :: stop()
+{
+    if(!running)
+        return;
+    running = false;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    Stats::get().add_time(phase, elapsed.count());
+}
+
+#endif
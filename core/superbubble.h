@@ -0,0 +1,186 @@
+#ifndef METACARVEL_SUPERBUBBLE_H
+#define METACARVEL_SUPERBUBBLE_H
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "contigs.h"
+#include "links.h"
+#include "stats.h"
+
+//Superbubbles of the oriented graph (spqr --superbubbles), a fast alternative to the separation
+//pairs of the SPQR trees when only bubbles are wanted. A superbubble (s,t) is a minimal acyclic
+//subgraph that is entered only through s and left only through t, with every vertex reachable
+//from s and reaching t, which is what layout's test_pair accepts as a bubble.
+//
+//Following Gaertner and Stadler, the vertices of a superbubble form an interval of a topological
+//order obtained from a depth first search started at the sources. With P(v) the first position
+//of a parent of v and C(v) the last position of a child of v, (s,t) is a superbubble exactly when
+//no vertex of (s,t] has a parent before s and the last child of the vertices of [s,t) is t. For
+//each s the smallest such t is found by jumping from C(s) to the last child of the interval so
+//far, with the interval minimum of P and maximum of C taken from sparse tables. Contigs on a
+//cycle get no parent and no child position, so no superbubble starts, ends or passes through
+//them. Everything takes O(m + n log n) plus one pair of table lookups per jump.
+class SuperbubbleFinder
+{
+public:
+    SuperbubbleFinder(const LinkArray &links, const ContigTable &contigs);
+    //writes "source sink members..." records, members including source and sink
+    void find(std::ostream &out);
+private:
+    const LinkArray &links;
+    const ContigTable &contigs;
+    LinkGraph graph;
+    std::vector<int> order;      //contigs in reverse DFS postorder
+    std::vector<bool> cyclic;    //contig lies in a strongly connected component of several contigs
+
+    void sort();
+};
+
+inline SuperbubbleFinder :: SuperbubbleFinder(const LinkArray &links, const ContigTable &contigs)
+    : links(links), contigs(contigs), graph(contigs.size(), links)
+{
+}
+
+//The intervals only hold for a DFS started at sources: a search entering a bubble at an inner
+//contig splits the bubble in the order. The first pass finds the strongly connected components,
+//the second starts only at contigs of components no other component links to, which reach every
+//contig. Roots are taken in name order so that the output does not depend on the order of the
+//links.
+inline void SuperbubbleFinder :: sort()
+{
+    std::vector<int> postorder;
+    std::vector<int> component = strong_components(links, graph, contigs.by_name(), postorder);
+    std::vector<bool> entered(postorder.size(), false);
+    for(int i = 0; i < int(links.size()); i++)
+        if(component[links[i].contig_a] != component[links[i].contig_b])
+            entered[component[links[i].contig_b]] = true;
+    std::vector<int> roots;
+    std::vector<int> names = contigs.by_name();
+    for(int i = 0; i < int(names.size()); i++)
+        if(component[names[i]] != -1 && !entered[component[names[i]]])
+            roots.push_back(names[i]);
+    component = strong_components(links, graph, roots, postorder);
+    std::vector<int> size(postorder.size(), 0);
+    for(int i = 0; i < int(postorder.size()); i++)
+        size[component[postorder[i]]]++;
+    cyclic.assign(contigs.size(), false);
+    for(int i = 0; i < int(postorder.size()); i++)
+        cyclic[postorder[i]] = size[component[postorder[i]]] > 1;
+    order.assign(postorder.rbegin(), postorder.rend());
+}
+
+//Range minimum and maximum queries in constant time after O(n log n) preprocessing.
+class SparseTable
+{
+public:
+    SparseTable(const std::vector<int> &values, bool maximum);
+    int query(int first, int last) const;     //over [first, last]
+private:
+    bool maximum;
+    std::vector<std::vector<int> > levels;
+    std::vector<int> log2;
+};
+
+inline SparseTable :: SparseTable(const std::vector<int> &values, bool maximum) : maximum(maximum)
+{
+    int n = values.size();
+    log2.assign(n + 1, 0);
+    for(int i = 2; i <= n; i++)
+        log2[i] = log2[i/2] + 1;
+    levels.push_back(values);
+    for(int k = 1; (1 << k) <= n; k++)
+    {
+        const std::vector<int> &prev = levels[k-1];
+        std::vector<int> level(n - (1 << k) + 1);
+        for(int i = 0; i < int(level.size()); i++)
+            level[i] = maximum ? std::max(prev[i], prev[i + (1 << (k-1))]) : std::min(prev[i], prev[i + (1 << (k-1))]);
+        levels.push_back(level);
+    }
+}
+
+inline int SparseTable :: query(int first, int last) const
+{
+    int k = log2[last - first + 1];
+    int a = levels[k][first], b = levels[k][last - (1 << k) + 1];
+    return maximum ? std::max(a, b) : std::min(a, b);
+}
+
+inline void SuperbubbleFinder :: find(std::ostream &out)
+{
+    ScopedTimer timer("superbubbles");
+    sort();
+    int n = order.size();
+    if(n == 0)
+        return;
+    std::vector<int> position(contigs.size(), -1);
+    for(int i = 0; i < n; i++)
+        position[order[i]] = i;
+    //no parent counts as a parent at -1 and no child as a child at n, so neither bounds a bubble
+    std::vector<int> first_parent(n, -1), last_child(n, n);
+    //forks[i] counts the contigs before position i with links to two different contigs
+    std::vector<int> forks(n + 1, 0);
+    for(int i = 0; i < n; i++)
+    {
+        int v = order[i];
+        bool fork = false;
+        for(int j = graph.out_offsets[v]; j < graph.out_offsets[v+1]; j++)
+            fork = fork || links[graph.out_links[j]].contig_b != links[graph.out_links[graph.out_offsets[v]]].contig_b;
+        forks[i+1] = forks[i] + fork;
+        if(cyclic[v])
+            continue;
+        if(graph.in_degree(v) > 0)
+        {
+            first_parent[i] = n;
+            for(int j = graph.in_offsets[v]; j < graph.in_offsets[v+1]; j++)
+                first_parent[i] = std::min(first_parent[i], position[links[graph.in_links[j]].contig_a]);
+        }
+        if(graph.out_degree(v) > 0)
+        {
+            last_child[i] = -1;
+            for(int j = graph.out_offsets[v]; j < graph.out_offsets[v+1]; j++)
+                last_child[i] = std::max(last_child[i], position[links[graph.out_links[j]].contig_b]);
+        }
+    }
+    SparseTable parents(first_parent, false), children(last_child, true);
+
+    long long found = 0, jumps = 0;
+    for(int s = 0; s < n; s++)
+    {
+        int t = last_child[s];
+        while(t < n)
+        {
+            jumps++;
+            if(parents.query(s + 1, t) < s)
+            {
+                t = n;
+                break;
+            }
+            int reach = children.query(s, t - 1);
+            if(reach == t)
+                break;
+            t = reach;
+        }
+        //a single path from s to t is no bubble
+        if(t >= n || forks[t] == forks[s])
+            continue;
+        found++;
+        out<<contigs.name(order[s])<<"\t"<<contigs.name(order[t]);
+        for(int i = s; i <= t; i++)
+            out<<"\t"<<contigs.name(order[i]);
+        out<<"\n";
+    }
+    Stats::get().count("superbubbles", found);
+    Stats::get().count("superbubble jumps", jumps);
+}
+
+inline void find_superbubbles(const LinkArray &links, const ContigTable &contigs, std::ostream &out)
+{
+    SuperbubbleFinder finder(links, contigs);
+    finder.find(out);
+}
+
+#endif
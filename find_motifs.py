@@ -1,5 +1,8 @@
 import networkx as nx
 import argparse
+import os
+from graphimage import read_oriented_graph
+from compression import open_text
 
 contig_coverage = {}
 
@@ -67,7 +70,7 @@ def find_interspersed_repeats(G,to_write):
 def find_three_bubbles(G,to_write,seppairs):
     explored = {}
     ofile = open(to_write,'w')
-    with open(seppairs,'r') as f:
+    with open_text(seppairs) as f:
         for line in f:
             attrs = line.split()
             if len(attrs) == 5:
@@ -76,7 +79,7 @@ def find_three_bubbles(G,to_write,seppairs):
 def find_four_bubbles(G,to_write,seppairs):
     explored = {}
     ofile = open(to_write,'w')
-    with open(seppairs,'r') as f:
+    with open_text(seppairs) as f:
         for line in f:
             attrs = line.split()
             if len(attrs) == 6:
@@ -84,7 +87,7 @@ def find_four_bubbles(G,to_write,seppairs):
 
 def find_complex_bubbles(G,to_write,seppairs):
     ofile = open(to_write,'w')
-    with open(seppairs,'r') as f:
+    with open_text(seppairs) as f:
         for line in f:
             attrs = line.split()
             if len(attrs) > 6:
@@ -104,12 +107,15 @@ def main():
     parser = argparse.ArgumentParser()
     parser.add_argument('-d','--working_dir',help='directory where all files exist',required=True)
     args = parser.parse_args()
-    with open(args.working_dir+'/contig_coverage','r') as f:
+    with open_text(args.working_dir+'/contig_coverage') as f:
         for line in f:
             attrs = line.split()
             contig_coverage[attrs[0]] = float(attrs[1])
 
-    G = nx.read_gml(args.working_dir+'/oriented.gml')
+    graph = args.working_dir+'/oriented.img'
+    if not os.path.exists(graph):
+        graph = args.working_dir+'/oriented.gml'
+    G = read_oriented_graph(graph)
 
     find_plasmids(G,args.working_dir+'/plasmids')
     #find_tandem_repeats(G,args.working_dir+'/tandem_repeats')
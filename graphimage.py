@@ -0,0 +1,89 @@
+import mmap
+import struct
+
+'''
+Read-only access to the graph images written by the C++ tools (core/image.h).
+
+The file is mapped into memory and every section is handed out as a memoryview over the mapping,
+so nothing is parsed or copied: image.array('mean')[i] reads the i-th double straight from the
+file (or from shared memory, for images in /dev/shm). image.numpy('mean') wraps the same memory
+in a numpy array.
+
+Images of kind "links" (bundler) index contigs by their id in the tool that wrote them. Images of
+kind "oriented" (orientcontigs, metacarvel) are snapshots of the oriented graph: their contig table
+holds the nodes of oriented.gml in the same order, with an orientation each.
+'''
+class GraphImage:
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.mm = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        self.buf = memoryview(self.mm)
+        magic, self.version, nsections, kind = struct.unpack_from('<4sII20s', self.mm, 0)
+        if magic != b'MCGI':
+            raise ValueError(path+' is not a MetaCarvel graph image')
+        self.kind = kind.split(b'\0', 1)[0].decode()
+        self.sections = {}
+        for i in range(nsections):
+            name, type, count, offset = struct.unpack_from('<24sc7xQQ', self.mm, 32 + 48*i)
+            self.sections[name.split(b'\0', 1)[0].decode()] = (type.decode(), count, offset)
+        self.ncontigs = self.sections['length'][1]
+        self.nlinks = self.sections['contig_a'][1] if 'contig_a' in self.sections else 0
+        self.name_offsets = self.array('name_offsets')
+        self.pool = self.array('names')
+
+    def array(self, name):
+        type, count, offset = self.sections[name]
+        size = struct.calcsize(type)
+        return self.buf[offset:offset + count*size].cast(type)
+
+    def numpy(self, name):
+        import numpy as np
+        type, count, offset = self.sections[name]
+        return np.frombuffer(self.mm, dtype=np.dtype(type), count=count, offset=offset)
+
+    def name(self, contig):
+        return bytes(self.pool[self.name_offsets[contig]:self.name_offsets[contig+1] - 1]).decode()
+
+    def names(self):
+        return [self.name(c) for c in range(self.ncontigs)]
+
+    def out_links(self, contig):
+        # links leaving contig (it is their contig_a), in link order
+        offsets = self.array('out_offsets')
+        return self.array('out_links')[offsets[contig]:offsets[contig+1]]
+
+    def in_links(self, contig):
+        offsets = self.array('in_offsets')
+        return self.array('in_links')[offsets[contig]:offsets[contig+1]]
+
+    def degree(self, contig):
+        out_offsets = self.array('out_offsets')
+        in_offsets = self.array('in_offsets')
+        return out_offsets[contig+1] - out_offsets[contig] + in_offsets[contig+1] - in_offsets[contig]
+
+def is_image(path):
+    with open(path, 'rb') as f:
+        return f.read(4) == b'MCGI'
+
+def read_oriented_graph(path):
+    # The oriented graph as a networkx DiGraph, from the oriented.img snapshot or from GML. Nodes
+    # and edges come in the same order and with the same attributes as nx.read_gml gives them,
+    # except that length, mean and stdev are numbers rather than the strings GML quotes them as.
+    import networkx as nx
+    if not is_image(path):
+        return nx.read_gml(path)
+    image = GraphImage(path)
+    if image.kind != 'oriented':
+        raise ValueError(path+' is a '+image.kind+' image, not an oriented graph')
+    names = image.names()
+    length = image.array('length')
+    orient = image.array('orient')
+    G = nx.DiGraph()
+    for c in range(image.ncontigs):
+        G.add_node(names[c], orientation='FOW' if orient[c] == 1 else 'REV', length=length[c])
+    contig_a, contig_b = image.array('contig_a'), image.array('contig_b')
+    end_a, end_b = image.array('end_a'), image.array('end_b')
+    mean, stdev, bsize = image.array('mean'), image.array('stdev'), image.array('bsize')
+    for l in range(image.nlinks):
+        G.add_edge(names[contig_a[l]], names[contig_b[l]], orientation=chr(end_a[l])+chr(end_b[l]), mean=mean[l], stdev=stdev[l], bsize=bsize[l])
+    return G
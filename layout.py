@@ -4,6 +4,8 @@ import sys
 #from networkx.drawing.nx_agraph import write_dot
 import operator
 import argparse
+from graphimage import read_oriented_graph
+from compression import open_text
 
 
 revcompl = lambda x: ''.join([{'A':'T','C':'G','G':'C','T':'A','N':'N','R':'N','M':'N','Y':'N','S':'N','W':'N','K':'N','a':'t','c':'g','g':'c','t':'a',' ':'','n':'n',}[B] for B in x][::-1])
@@ -307,7 +309,7 @@ This  is main method
 def main():
     parser = argparse.ArgumentParser()
     parser.add_argument('-a','--assembly', help='Contig assembly', required=True)
-    parser.add_argument('-g','--oriented_graph', help='Oriented Graph of Contigs', required=True)
+    parser.add_argument('-g','--oriented_graph', help='Oriented Graph of Contigs, the oriented.img snapshot or GML', required=True)
     parser.add_argument('-s','--seppairs', help='Separation pairs detected in the graph', required=True)
     parser.add_argument('-o','--output', help='Output file for scaffold sequences', required=True)
     parser.add_argument('-e','--gfa', help='Output file for graph in GFA format', required=True)
@@ -316,14 +318,14 @@ def main():
 
     args = parser.parse_args()
     bub_output = open(args.bub,'w')
-    G = nx.read_gml(args.oriented_graph)
+    G = read_oriented_graph(args.oriented_graph)
     write_GFA(G,args.gfa)
     #sys.exit()
     #G = nx.read_gml("small.gml")
     #nx.write_gexf(G,'original.gexf')
     pairmap = {}
     pair_list = []
-    with open(args.seppairs,'r') as f:
+    with open_text(args.seppairs) as f:
         for line in f:
             attrs = line.split()
             if attrs[0] <= attrs[1]:
@@ -623,7 +625,7 @@ def main():
 
     # print len(primary_contigs)
     # print alternative_contigs
-    assembly = open(args.assembly,'r')
+    assembly = open_text(args.assembly)
     sequences = parse_fasta(assembly.readlines())
     ofile = open(args.output,'w')
     scaffolded = {}
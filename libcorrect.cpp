@@ -1,319 +1,98 @@
 #include <iostream>
-#include <algorithm>
-#include <map>
 #include <string>
-#include <cstring>
 #include <fstream>
-#include <cmath>
-#include <queue>
-#include <numeric>
-#include <unordered_map>
+#include <vector>
 
 #include "cmdline/cmdline.h"
+#include "core/contigs.h"
+#include "core/links.h"
+#include "core/compress.h"
+#include "core/resources.h"
+#include "core/correct.h"
 
 using namespace std;
 
-class BedRecord
-{
-public:
-	string contig;
-	int start;
-	int end;
-	char strand;//+ forward - reverse
-	BedRecord () {}
-	BedRecord(string contig, int start, int end, char strand);
-
-};
-
-BedRecord :: BedRecord(string contig, int start, int end, char strand)
-{
-	this->contig = contig;
-	this->start = start;
-	this->end = end;
-	this->strand = strand;
-}
-
-//change readnames to ids
-map<string,BedRecord> first_in_pair;
-map<string, BedRecord> second_in_pair;
-
-char* getCharExpr(string s)
-{
-        char *a=new char[s.size()+1];
-        a[s.size()]=0;
-        memcpy(a,s.c_str(),s.size());
-        return a;
-}
-
-void parse_bed(string path)
-{
-	ifstream bedfile(getCharExpr(path));
-	string line;
-	unordered_map<string,int> seen;
-	while(getline(bedfile,line))
-	{	
-		string contig, read;
-		char strand;
-		int start,end,flag;
-		istringstream iss(line);
-		iss >> contig >> start >> end >> read >> flag >> strand;
-		BedRecord rec(contig,start,end,strand);
-		if(read[read.length()-2] == '/')
-		{
-			if(read[read.length() -1 ] == '1')
-			{
-				first_in_pair[read.substr(0,read.length()-2)] = rec;
-			}	
-			else
-			{	
-				second_in_pair[read.substr(0,read.length()-2)] = rec;
-			}
-		}
-		else
-		{
-			if(seen.find(read) == seen.end())
-		    {
-		    	first_in_pair[read] = rec;
-				seen[read] = true;
-		    }
-		    else
-		    {
-				second_in_pair[read] = rec;
-		    }
-
-		}
-
-	}
-}
-
-
-class LibRecord
-{
-public:
-	string lib_id;
-	string read_1;
-	string read_2;
-	string format;
-	double mean;
-	double stdev;
-	double maximum;
-	double minimum;
-	string orientation;
-	LibRecord() {}
-	LibRecord(string lib_id, string read_1, string read_2, string format, double mean, double stdev,double maximum, double minimum, string orientation);
-	
-};
-
-LibRecord :: LibRecord(string lib_id, string read_1, string read_2, string format, double mean, double stdev,double maximum, double minimum, string orientation)
-{
-	this->lib_id = lib_id;
-	this->read_1 = read_1;
-	this->read_2 = read_2;
-	this->format = format;
-	this->mean = mean;
-	this->stdev = stdev;
-	this->maximum = maximum;
-	this->minimum = minimum;
-	this->orientation = orientation;
-}
-
-map<string, int> contig2length;
-map<string, int> contig2bases;
-map<string, int> contig2reads;
-
-
-void get_contig_length(string file)
-{
-	ifstream lenfile(getCharExpr(file));
-	string line;
-	while(getline(lenfile,line))
-	{
-		istringstream iss(line);
-		string contig;
-		int len;
-		iss >> contig >> len;
-		contig2length[contig] = len;
-	}
-}
-
-
-
-map<string,string> getFastqSequences(string file)
-{
-	map<string, string> ret;
-	ifstream fastqfile(getCharExpr(file));
-	string line,seqname,seq;
-	bool prevlineseqname = false;
-	while(getline(fastqfile,line))
-	{
-		if(line[0] == '@')
-		{
-			seqname = line.substr(1);
-			int space = int(seqname.find(" "));
-			seqname = seqname.substr(0,space);
-			prevlineseqname = true;
-			continue;
-		}
-		if(prevlineseqname == true)
-		{
-			seq = line;
-			ret[seqname] = seq;
-			prevlineseqname = false;
-		}
-	}
-	return ret;
-}
-
-int get_insert_size(int start1, int end1, int start2, int end2)
-{
-	if(start1 <= start2)
-	{
-		return end2 - start1 + 1;		
-	}
-	else
-	{
-		return end1 - start2 + 1;
-	}
-}
-
-double estimate_distance(double mean, int start1, int end1, int start2, int end2, int ctg1_length, int ctg2_length, string orientation)
-{
-	int read1_length = end1 - start1 + 1;
-	int read2_length = end2 - start2 + 1;
-	int offset1,offset2;
-	
-	if(orientation == "EB")
-	{
-		offset1 = ctg1_length - end1;
-		offset2 = start2;
-	}
-	//Need to work out BB and EE properly with reasoning
-	if(orientation == "BB")
-	{
-		offset1 = start1;
-		offset2 = start2;
-	}
-	if(orientation == "EE")
-	{
-		offset1 = ctg1_length - end1;
-		offset2 = ctg2_length - end2;
-	}
-	if(orientation == "BE")
-	{
-		offset1 = start1;
-		offset2 = ctg2_length - end2;
-	}
-
-	return mean - read1_length - read2_length - offset2 - offset1;
-}
-
-
-
 int main(int argc, char* argv[])
 {
     cmdline ::parser pr;
     //pr.add<string>("lib_info",'l',"file containing information about library",true,"");
-    pr.add<string>("alignment_info",'a',"alignment of read to assembled contigs in bed format",true,"");
+    pr.add<string>("alignment_info",'a',"alignment of read to assembled contigs in bed format",false,"");
+    pr.add<string>("first_mates",'1',"alignments of the first mates mapped as single end reads, instead of -a",false,"");
+    pr.add<string>("second_mates",'2',"alignments of the second mates, in a file of their own",false,"");
+    pr.add("ordered",'\0',"the mate files list the reads in the same order, join them in lockstep");
+    pr.add<double>("end_proximity",'e',"drop pairs implying a gap below -K stdev of the insert size, their reads lying too far from the contig ends; 0 keeps them all",false,0);
+    pr.add("dedup",'\0',"collapse read pairs aligned to the same positions (PCR and optical duplicates) into a single link");
+    pr.add<int>("max_links",'\0',"keep a random sample of at most this many links per contig pair and orientation, each standing for its share of the pairs; 0 keeps them all",false,0);
+    pr.add("prefilter",'\0',"count read names in a first pass and only store reads that occur twice, saving the memory of unpaired reads");
     pr.add<string>("contig_file",'d',"file containing length of contigs",true,"");
     pr.add<string>("coverage_file",'x',"file to output coverage of contigs",true,"");
     pr.add<int>("length_cutoff",'c',"length cutoff on contigs to be used for scaffolding",false,500);
     pr.add<string>("output",'o',"output file",true,"");
+    pr.add<int>("threads",'t',"number of threads, all CPUs available to the process by default",false,0);
+    pr.add<string>("max-memory",'M',"memory budget such as 800M or 16G, the cgroup memory limit by default",false,"");
+    pr.add("stats",'\0',"print time spent in each phase and counters to stderr");
     pr.parse_check(argc,argv);
-
-    get_contig_length(pr.get<string>("contig_file"));
-	vector<LibRecord> libraries;
-	string line;
-	int threshold = pr.get<int>("length_cutoff");
-	parse_bed(pr.get<string>("alignment_info"));
-	vector<int> insert_sizes;
-	cerr<<"Size of First Map = "<<first_in_pair.size()<<endl;
-	cerr<<"Size of Second Map = "<<second_in_pair.size()<<endl;
-	
-	map<string,BedRecord> :: iterator it;
-	
-	for(it = first_in_pair.begin(); it != first_in_pair.end();++it)
+    if(pr.exist("stats"))
+        Stats::get().enable();
+    if(!Resources::get().set(pr.get<int>("threads"), pr.get<string>("max-memory")))
+    {
+        cerr<<"invalid memory size "<<pr.get<string>("max-memory")<<endl;
+        return 1;
+    }
+
+    ContigTable contigs;
+    load_contig_lengths(pr.get<string>("contig_file"), contigs);
+	LinkCriteria criteria(pr.get<int>("length_cutoff"), pr.get<double>("end_proximity"), pr.exist("dedup"), pr.get<int>("max_links"));
+	string bed = pr.get<string>("alignment_info");
+	bool mate_files = pr.get<string>("first_mates") != "" && pr.get<string>("second_mates") != "";
+	if(bed == "" && !mate_files)
 	{
-		string read = it->first;
-		BedRecord first = it->second;
-		if(second_in_pair.find(read) != second_in_pair.end())
-		{
-			BedRecord second = second_in_pair[read];
-			if(first.contig == second.contig)
-			{
-				if(contig2reads.find(first.contig) == contig2reads.end())
-				{
-					contig2reads[first.contig] = 0;
-				}
-				contig2reads[first.contig] += 1;
-				int insert_size = get_insert_size(first.start, first.end, second.start, second.end);
-				insert_sizes.push_back(insert_size);
-			}
-		}
+		cerr<<"either an alignment file (-a) or the alignments of both mates (-1 and -2) are required"<<endl;
+		cerr<<pr.usage();
+		return 1;
 	}
-	
-
-	double sum = std::accumulate(insert_sizes.begin(), insert_sizes.end(), 0.0);
-	double mean = sum / insert_sizes.size();
-	
-	cerr<<"Sum = "<<sum<<endl;
-    cerr<<"Size = "<<insert_sizes.size()<<endl;
-
-    std::vector<double> diff(insert_sizes.size());
-	std::transform(insert_sizes.begin(), insert_sizes.end(), diff.begin(), std::bind2nd(std::minus<double>(), mean));
-	double sq_sum = std::inner_product(diff.begin(), diff.end(), diff.begin(), 0.0);
-	double stdev = std::sqrt(sq_sum / insert_sizes.size());
-	
-	cerr<<"Mean = "<<mean<<endl;
-	cerr<<"Stdev = "<<stdev<<endl;
-	//calculate coverage
-	ofstream covfile(getCharExpr(pr.get<string>("coverage_file")));
-	for(map<string,int> :: iterator it = contig2reads.begin(); it != contig2reads.end(); ++it)
+	vector<int> contig_reads;
+	InsertModel model;
+	LinkArray links;
+	int parts = mate_files ? 1 : pairing_partitions(bed);
+	if(mate_files)
 	{
-		int len = contig2length[it->first];
-		double coverage = it->second * 1.0 * mean / len;
-		covfile<<it->first<<"\t"<<coverage<<endl;
+		long long first_mates, second_mates;
+		model = pair_mate_files(pr.get<string>("first_mates"), pr.get<string>("second_mates"), pr.exist("ordered"), contigs, criteria, contig_reads, links, first_mates, second_mates);
+		cerr<<"Size of First Map = "<<first_mates<<endl;
+		cerr<<"Size of Second Map = "<<second_mates<<endl;
 	}
-	//calculate links between contigs based on mate pair information, iterate through maps of mate pairs and find links
-	ofstream ofile(getCharExpr(pr.get<string>("output")));
-	for(it = first_in_pair.begin(); it != first_in_pair.end(); ++it)
+	else if(parts > 1)
 	{
-		BedRecord first = it->second;
-		string firstcontigend, secondcontigend;
-		if(second_in_pair.find(it->first) != second_in_pair.end())
-		{
-			BedRecord second = second_in_pair[it->first];
-			if(contig2length[first.contig] <= threshold || contig2length[second.contig] <= threshold)
-			{
-				continue;
-			}
-			if(first.contig != second.contig)
-			{
-				if(first.strand == '+' && second.strand == '+')
-				{
-					firstcontigend = "E";
-					secondcontigend = "E";
-				}
-				if(first.strand == '+' && second.strand == '-')
-				{
-					firstcontigend = "E";
-					secondcontigend = "B";
-				}
-				if(first.strand == '-' && second.strand == '+')
-				{
-					firstcontigend = "B";
-					secondcontigend = "E";
-				}
-				if(first.strand == '-' && second.strand == '-')
-				{
-					firstcontigend = "B";
-					secondcontigend = "B";
-				}
-				double dist = estimate_distance(mean,first.start,first.end,second.start,second.end,contig2length[first.contig],contig2length[second.contig],firstcontigend+secondcontigend);
-					
-				ofile << first.contig<<"\t"<<firstcontigend<<"\t"<<second.contig<<"\t"<<secondcontigend<<"\t"<<dist<<"\t"<<stdev<<endl;
-
-			}
-		}
+		//the maps of mates would not fit the memory budget, pair the reads partition by partition
+		cerr<<"Pairing reads in "<<parts<<" partitions to stay within the memory budget"<<endl;
+		long long first_mates, second_mates;
+		model = pair_partitioned(bed, pr.get<string>("output") + ".spill", parts, pr.exist("prefilter"), contigs, criteria, contig_reads, links, first_mates, second_mates);
+		cerr<<"Size of First Map = "<<first_mates<<endl;
+		cerr<<"Size of Second Map = "<<second_mates<<endl;
+	}
+	else
+	{
+		ReadPairs pairs;
+		parse_bed(bed, contigs, pairs, pr.exist("prefilter"));
+		cerr<<"Size of First Map = "<<pairs.first_in_pair.size()<<endl;
+		cerr<<"Size of Second Map = "<<pairs.second_in_pair.size()<<endl;
+		model = estimate_insert_size(pairs, contigs.size(), contig_reads);
+		generate_links(pairs, contigs, model, criteria, links);
 	}
+	cerr<<"Sum = "<<model.sum<<endl;
+    cerr<<"Size = "<<model.count<<endl;
+	cerr<<"Mean = "<<model.mean<<endl;
+	cerr<<"Stdev = "<<model.stdev<<endl;
+
+	//calculate coverage
+	OutputFile covfile(pr.get<string>("coverage_file"));
+	write_coverage(covfile, contigs, contig_reads, model.mean);
+	close_or_exit(covfile);
+
+	OutputFile ofile(pr.get<string>("output"));
+	write_links(ofile, contigs, links, false);
+	close_or_exit(ofile);
+	Stats::get().write(cerr);
 	return 0;
 }
@@ -0,0 +1,198 @@
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <vector>
+
+#include "cmdline/cmdline.h"
+#include "core/contigs.h"
+#include "core/links.h"
+#include "core/compress.h"
+#include "core/resources.h"
+#include "core/correct.h"
+#include "core/bundle.h"
+#include "core/orient.h"
+#include "core/acyclic.h"
+#include "core/seppairs.h"
+#include "core/superbubble.h"
+#include "core/image.h"
+
+using namespace std;
+
+//Runs libcorrect, bundler, orientcontigs and spqr in one process. Links are handed from stage to
+//stage in memory, intermediate files are only written with --keep. The oriented graph is written
+//as the oriented.img snapshot, and as oriented.gml with --gml or --keep.
+//
+//With --repeats the run stops after the first orientation pass, leaving the graph image
+//bundled_links.img and invalidated_counts_unfiltered for the repeat filter. The filtered links are then passed back with --links
+//to orient the contigs and find separation pairs.
+
+string path(const string &dir, const string &file)
+{
+    return dir + "/" + file;
+}
+
+int main(int argc, char* argv[])
+{
+    cmdline ::parser pr;
+    pr.add<string>("alignment_info",'a',"alignment of read to assembled contigs in bed format",false,"");
+    pr.add<string>("first_mates",'1',"alignments of the first mates mapped as single end reads, instead of -a",false,"");
+    pr.add<string>("second_mates",'2',"alignments of the second mates, in a file of their own",false,"");
+    pr.add("ordered",'\0',"the mate files list the reads in the same order, join them in lockstep");
+    pr.add<double>("end_proximity",'e',"drop pairs implying a gap below -K stdev of the insert size, their reads lying too far from the contig ends; 0 keeps them all",false,0);
+    pr.add("dedup",'\0',"collapse read pairs aligned to the same positions (PCR and optical duplicates) into a single link");
+    pr.add<int>("max_links",'\0',"keep a random sample of at most this many links per contig pair and orientation, each standing for its share of the pairs; 0 keeps them all",false,0);
+    pr.add("prefilter",'\0',"count read names in a first pass and only store reads that occur twice, saving the memory of unpaired reads");
+    pr.add<string>("contig_file",'d',"file containing length of contigs",true,"");
+    pr.add<string>("dir",'o',"output directory",true,"");
+    pr.add<int>("length_cutoff",'c',"length cutoff on contigs to be used for scaffolding",false,500);
+    pr.add<int>("bsize",'b',"number of mate pairs to support an edge",false,3);
+    pr.add<int>("binned",'\0',"bundle groups of more than this many links approximately, on a histogram of their intervals; 0 sweeps all groups exactly",false,0);
+    pr.add<double>("bin_width",'\0',"histogram bin width of --binned, the links of a bundle are within this distance of overlapping",false,10);
+    pr.add("spectral",'\0',"orient by the leading eigenvector of the signed link matrix instead of a greedy BFS");
+    pr.add("acyclic",'\0',"also invalidate a light feedback arc set, leaving the oriented graph acyclic");
+    pr.add("superbubbles",'u',"write the superbubbles of the oriented graph to seppairs instead of the separation pairs of its SPQR trees");
+    pr.add<int>("max_component_edges",'\0',"write only the cut vertex pair of biconnected components with more links than this instead of decomposing them; 0 for no limit",false,0);
+    pr.add<double>("max_component_seconds",'\0',"give up decomposing a biconnected component after this many seconds and write only its cut vertex pair; 0 for no limit",false,0);
+    pr.add<string>("links",'l',"start from this file of bundled links instead of the alignments",false,"");
+    pr.add("repeats",'r',"stop after the first orientation pass to filter repeats");
+    pr.add("keep",'k',"write all intermediate files");
+    pr.add("gml",'g',"also write the oriented graph in GML format");
+    pr.add<int>("threads",'t',"number of threads, all CPUs available to the process by default",false,0);
+    pr.add<string>("max-memory",'M',"memory budget such as 800M or 16G, the cgroup memory limit by default",false,"");
+    pr.add("stats",'\0',"print time spent in each phase and counters to stderr");
+    pr.parse_check(argc,argv);
+    if(pr.exist("stats"))
+        Stats::get().enable();
+    if(!Resources::get().set(pr.get<int>("threads"), pr.get<string>("max-memory")))
+    {
+        cerr<<"invalid memory size "<<pr.get<string>("max-memory")<<endl;
+        return 1;
+    }
+
+    string dir = pr.get<string>("dir");
+    bool keep = pr.exist("keep");
+    bool mate_files = pr.get<string>("first_mates") != "" && pr.get<string>("second_mates") != "";
+    if(pr.get<string>("alignment_info") == "" && !mate_files && pr.get<string>("links") == "")
+    {
+        cerr<<"either an alignment file (-a), the alignments of both mates (-1 and -2) or bundled links (-l) are required"<<endl;
+        cerr<<pr.usage();
+        return 1;
+    }
+
+    ContigTable contigs;
+    load_contig_lengths(pr.get<string>("contig_file"), contigs);
+    LinkArray bundled;
+    if(pr.get<string>("links") != "")
+    {
+        read_links(pr.get<string>("links"), contigs, bundled, true);
+        cerr<<"Bundled links loaded = "<<bundled.size()<<endl;
+    }
+    else
+    {
+        string bed = pr.get<string>("alignment_info");
+        LinkCriteria criteria(pr.get<int>("length_cutoff"), pr.get<double>("end_proximity"), pr.exist("dedup"), pr.get<int>("max_links"));
+        vector<int> contig_reads;
+        InsertModel model;
+        LinkArray links;
+        int parts = mate_files ? 1 : pairing_partitions(bed);
+        if(mate_files)
+        {
+            long long first_mates, second_mates;
+            model = pair_mate_files(pr.get<string>("first_mates"), pr.get<string>("second_mates"), pr.exist("ordered"), contigs, criteria, contig_reads, links, first_mates, second_mates);
+            cerr<<"Size of First Map = "<<first_mates<<endl;
+            cerr<<"Size of Second Map = "<<second_mates<<endl;
+        }
+        else if(parts > 1)
+        {
+            cerr<<"Pairing reads in "<<parts<<" partitions to stay within the memory budget"<<endl;
+            long long first_mates, second_mates;
+            model = pair_partitioned(bed, path(dir,"alignment.spill"), parts, pr.exist("prefilter"), contigs, criteria, contig_reads, links, first_mates, second_mates);
+            cerr<<"Size of First Map = "<<first_mates<<endl;
+            cerr<<"Size of Second Map = "<<second_mates<<endl;
+        }
+        else
+        {
+            ReadPairs pairs;
+            parse_bed(bed, contigs, pairs, pr.exist("prefilter"));
+            cerr<<"Size of First Map = "<<pairs.first_in_pair.size()<<endl;
+            cerr<<"Size of Second Map = "<<pairs.second_in_pair.size()<<endl;
+            model = estimate_insert_size(pairs, contigs.size(), contig_reads);
+            generate_links(pairs, contigs, model, criteria, links);
+        }
+        cerr<<"Mean = "<<model.mean<<endl;
+        cerr<<"Stdev = "<<model.stdev<<endl;
+        OutputFile covfile(path(dir,"contig_coverage"));
+        write_coverage(covfile, contigs, contig_reads, model.mean);
+        close_or_exit(covfile);
+
+        cerr<<"Links between contigs = "<<links.size()<<endl;
+        if(keep)
+        {
+            OutputFile linkfile(path(dir,"contig_links"));
+            write_links(linkfile, contigs, links, false);
+            close_or_exit(linkfile);
+        }
+
+        int cutoff = pr.get<int>("bsize");
+        LinkArray bundled_links = bundle_links(links, contigs, cutoff, pr.get<int>("binned"), pr.get<double>("bin_width"));
+        bundled = supported_links(bundled_links, cutoff);
+        cerr<<"Bundled links = "<<bundled.size()<<endl;
+        if(keep)
+        {
+            OutputFile g(path(dir,"bundled_graph.gml"));
+            write_bundled_graph(g, contigs, bundled_links, cutoff);
+            close_or_exit(g);
+        }
+        if(keep)
+        {
+            OutputFile ofile(path(dir,"bundled_links"));
+            write_links(ofile, contigs, bundled, true);
+            close_or_exit(ofile);
+        }
+        if(pr.exist("repeats"))
+            write_link_image(path(dir,"bundled_links.img"), contigs, bundled);
+    }
+
+    Orientation orientation;
+    orient_contigs(bundled, contigs, pr.exist("spectral") ? "spectral" : "bsize", false, orientation);
+    if(pr.exist("repeats"))
+    {
+        OutputFile invalidfile(path(dir,"invalidated_counts_unfiltered"));
+        write_invalidated_counts(invalidfile, contigs, orientation);
+        close_or_exit(invalidfile);
+        Stats::get().write(cerr);
+        return 0;
+    }
+    if(keep)
+    {
+        OutputFile invalidfile(path(dir,"invalidated_counts"));
+        write_invalidated_counts(invalidfile, contigs, orientation);
+        close_or_exit(invalidfile);
+    }
+    if(pr.exist("acyclic"))
+        remove_cycles(bundled, contigs, orientation);
+
+    write_oriented_image(path(dir,"oriented.img"), contigs, bundled, orientation);
+    if(keep || pr.exist("gml"))
+    {
+        OutputFile gml(path(dir,"oriented.gml"));
+        write_oriented_graph(gml, contigs, bundled, orientation);
+        close_or_exit(gml);
+    }
+    LinkArray oriented = valid_links(bundled, orientation);
+    if(keep)
+    {
+        OutputFile tablinks(path(dir,"oriented_links"));
+        write_links(tablinks, contigs, oriented, true);
+        close_or_exit(tablinks);
+    }
+
+    OutputFile seppairs(path(dir,"seppairs"));
+    if(pr.exist("superbubbles"))
+        find_superbubbles(oriented, contigs, seppairs);
+    else
+        find_separation_pairs(oriented, contigs, seppairs, ComponentBudget(pr.get<int>("max_component_edges"), pr.get<double>("max_component_seconds")));
+    close_or_exit(seppairs);
+    Stats::get().write(cerr);
+    return 0;
+}
@@ -0,0 +1,86 @@
+import gzip
+import json
+import os
+import subprocess
+import threading
+import time
+
+from compression import file_compression
+from graphimage import GraphImage, is_image
+
+'''
+Per stage resource usage, written to profile.json in the output directory.
+
+Times and peak memory come from the rusage that wait4 returns for each stage, which covers the
+shell the stage runs in and everything it waited for. Block I/O is what went to or came from the
+devices (page cache hits don't count), input and output bytes are the sizes of the stage's files,
+and records counts the lines of every output file of a stage that succeeded, after decompressing
+it, or the links of a graph image. Records are counted on a thread of their own, so the scheduler
+goes on launching stages while large outputs are read.
+'''
+def count_lines(path):
+    lines = 0
+    kind = file_compression(path)
+    p = None
+    if kind == 'gz':
+        f = gzip.open(path, 'rb')
+    elif kind == 'zst':
+        p = subprocess.Popen(['zstd', '-dcq', path], stdout=subprocess.PIPE)
+        f = p.stdout
+    else:
+        f = open(path, 'rb')
+    with f:
+        for block in iter(lambda: f.read(1 << 20), b''):
+            lines += block.count(b'\n')
+    if p is not None:
+        p.wait()
+    return lines
+
+def count_records(path):
+    if is_image(path):
+        return GraphImage(path).nlinks
+    return count_lines(path)
+
+def file_sizes(paths):
+    return sum(os.path.getsize(p) for p in paths if os.path.exists(p))
+
+class Profile:
+    def __init__(self, path):
+        self.path = path
+        self.started = time.time()
+        self.stages = []
+        self.counting = []
+
+    def skipped(self, stage, status):
+        # stages reused from the checkpoint or not run because a dependency failed
+        self.stages.append({'stage': stage.name, 'status': status})
+
+    def finished(self, stage, status, wall, rusage):
+        entry = {'stage': stage.name,
+                 'status': 'done' if status == 0 else 'failed',
+                 'exit_status': status,
+                 'cores': stage.cores,
+                 'wall_seconds': round(wall, 3),
+                 'user_seconds': round(rusage.ru_utime, 3),
+                 'system_seconds': round(rusage.ru_stime, 3),
+                 'max_rss_kb': rusage.ru_maxrss,
+                 'block_read_bytes': rusage.ru_inblock * 512,
+                 'block_write_bytes': rusage.ru_oublock * 512,
+                 'input_bytes': file_sizes(stage.inputs),
+                 'output_bytes': file_sizes(stage.outputs)}
+        self.stages.append(entry)
+        if status == 0:
+            # the outputs of a failed stage are partial and removed by its cleanup
+            thread = threading.Thread(target=self.count, args=(entry, stage.outputs))
+            thread.start()
+            self.counting.append(thread)
+
+    def count(self, entry, outputs):
+        entry['records'] = dict((os.path.basename(p), count_records(p)) for p in outputs if os.path.exists(p))
+
+    def save(self):
+        for thread in self.counting:
+            thread.join()
+        self.counting = []
+        with open(self.path, 'w') as f:
+            json.dump({'wall_seconds': round(time.time() - self.started, 3), 'stages': self.stages}, f, indent=1)
@@ -1,6 +1,8 @@
 import sys
 import numpy as np
 import networkx as nx
+from graphimage import GraphImage, is_image
+from compression import open_text
 
 contig_coverage = {}
 contig_degree = {}
@@ -8,47 +10,62 @@ contig2links = {}
 central_nodes = {}
 contig_length = {}
 #contig coverages
-with open(sys.argv[1],'r') as f:
+with open_text(sys.argv[1]) as f:
     for line in f:
         attrs = line.split()
         contig_coverage[attrs[0]] = float(attrs[1])
 
-#contig degree, bundled links
-G = nx.MultiGraph()
-with open(sys.argv[2],'r') as f:
-    for line in f:
-        attrs = line.split()
-        G.add_edge(attrs[0],attrs[2])
-
-for node in G.nodes():
-    contig_degree[node] = G.degree(node)
+#contig degree, bundled links. These are either the bundled_links TSV or the graph image bundler
+#writes, which is used in place through its CSR arrays
+image = None
+if is_image(sys.argv[2]):
+    image = GraphImage(sys.argv[2])
+    names = image.names()
+    contig_a = image.array('contig_a')
+    contig_b = image.array('contig_b')
+    neighbors = {}
+    for c in range(image.ncontigs):
+        if image.degree(c) == 0:
+            continue
+        contig_degree[names[c]] = image.degree(c)
+        neighbors[names[c]] = set(names[contig_b[l]] for l in image.out_links(c)) | set(names[contig_a[l]] for l in image.in_links(c))
+else:
+    G = nx.MultiGraph()
+    with open_text(sys.argv[2]) as f:
+        for line in f:
+            attrs = line.split()
+            G.add_edge(attrs[0],attrs[2])
+    neighbors = {}
+    for node in G.nodes():
+        contig_degree[node] = G.degree(node)
+        neighbors[node] = list(G.neighbors(node))
 
 #invalidated links
-with open(sys.argv[3],'r') as f:
+with open_text(sys.argv[3]) as f:
     for line in f:
         attrs = line.split()
         contig2links[attrs[0]] = int(attrs[1])
 
 #skewed links
 skewed_edges = {}
-for node in G.nodes():
+for node in neighbors:
     s_count = 0
-    for neighs in G.neighbors(node):
+    for neighs in neighbors[node]:
         if node in contig_coverage and neighs in contig_coverage:
             if contig_coverage[node] >= 2*contig_coverage[neighs]:
                     s_count += 1
-    skewed_edges[node] = s_count*1.0/len(list(G.neighbors(node)))
+    skewed_edges[node] = s_count*1.0/len(neighbors[node])
 
 #centralities
 centralities = {}
-with open(sys.argv[4],'r') as f:
+with open_text(sys.argv[4]) as f:
     for line in f:
         attrs = line.split()
         centralities[attrs[0]] = float(attrs[1])
 
 #centralities = nx.betweenness_centrality(G)
 #lengths
-with open(sys.argv[5],'r') as f:
+with open_text(sys.argv[5]) as f:
     for line in f:
         attrs = line.split()
         contig_length[attrs[0]] = int(attrs[1])
@@ -100,27 +117,41 @@ for key in other_repeats:
     repeat_contigs.add(key)
 
 
-with open(sys.argv[2],'r') as f:
-    for line in f:
-        attrs = line.split()
-        dist = float(attrs[4])
-        #if contig_coverage[attrs[0]] >= 3.5*avg_coverage or contig_coverage[attrs[2]] >=33.5*avg_coverage:
-        #   continue
-        if mean != 0 and stdev != 0 and attrs[0] in repeats or attrs[2] in repeats:
+def bundled_lines():
+    if image is None:
+        with open_text(sys.argv[2]) as f:
+            for line in f:
+                yield line
+        return
+    # formatted the way the C++ tools write links, so distances are rounded as in the TSV
+    end_a = image.array('end_a')
+    end_b = image.array('end_b')
+    mean = image.array('mean')
+    stdev = image.array('stdev')
+    bsize = image.array('bsize')
+    for l in range(image.nlinks):
+        yield '%s\t%s\t%s\t%s\t%g\t%g\t%d\n' % (names[contig_a[l]],chr(end_a[l]),names[contig_b[l]],chr(end_b[l]),mean[l],stdev[l],bsize[l])
+
+for line in bundled_lines():
+    attrs = line.split()
+    dist = float(attrs[4])
+    #if contig_coverage[attrs[0]] >= 3.5*avg_coverage or contig_coverage[attrs[2]] >=33.5*avg_coverage:
+    #   continue
+    if mean != 0 and stdev != 0 and attrs[0] in repeats or attrs[2] in repeats:
+        continue
+    if attrs[0] in other_repeats or attrs[2] in other_repeats:
+        continue
+    if dist < 0:
+        if abs(dist) >= contig_length[attrs[0]] or abs(dist) >= contig_length[attrs[2]]:
+            if abs(dist) >= contig_length[attrs[0]]:
+                repeat_contigs.add(attrs[0])
+            if abs(dist) >= contig_length[attrs[2]]:
+                repeat_contigs.add(attrs[2])
             continue
-        if attrs[0] in other_repeats or attrs[2] in other_repeats:
+        else:
+            print(line.strip())
             continue
-        if dist < 0:
-            if abs(dist) >= contig_length[attrs[0]] or abs(dist) >= contig_length[attrs[2]]:
-                if abs(dist) >= contig_length[attrs[0]]:
-                    repeat_contigs.add(attrs[0])
-                if abs(dist) >= contig_length[attrs[2]]:
-                    repeat_contigs.add(attrs[2])
-                continue
-            else:
-                print(line.strip())
-                continue
-        print(line.strip())
+    print(line.strip())
 
 ofile = open(sys.argv[6],'w')
 #pool =  ThreadPool(cpus)
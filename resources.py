@@ -0,0 +1,53 @@
+import os
+
+'''
+CPUs the pipeline may use. os.cpu_count() and multiprocessing.cpu_count() report every CPU of the
+machine, even when the process is pinned to a few of them or runs in a container or batch job
+whose cgroup allows only a fraction of that time. available_cpus() takes both into account, like
+core/resources.h does for the C++ tools.
+'''
+
+def cgroup_value(path):
+    try:
+        with open(path) as f:
+            return f.readline().strip()
+    except (IOError, OSError):
+        return ''
+
+def cgroup_path():
+    # path of this process in the unified (v2) hierarchy
+    try:
+        with open('/proc/self/cgroup') as f:
+            for line in f:
+                if line.startswith('0::'):
+                    return line[3:].strip()
+    except (IOError, OSError):
+        pass
+    return ''
+
+def cgroup_cpu_limit():
+    # CPUs allowed by the cgroup quota, rounded up, or 0 without a quota
+    quota, period = -1, 0
+    v2 = cgroup_value('/sys/fs/cgroup'+cgroup_path()+'/cpu.max') or cgroup_value('/sys/fs/cgroup/cpu.max')
+    if v2:
+        fields = v2.split()
+        if fields[0] != 'max':
+            quota, period = int(fields[0]), int(fields[1])
+    else:
+        q = cgroup_value('/sys/fs/cgroup/cpu/cpu.cfs_quota_us')
+        p = cgroup_value('/sys/fs/cgroup/cpu/cpu.cfs_period_us')
+        if q and p:
+            quota, period = int(q), int(p)
+    if quota <= 0 or period <= 0:
+        return 0
+    return (quota + period - 1) // period
+
+def available_cpus():
+    try:
+        cpus = len(os.sched_getaffinity(0))
+    except AttributeError:
+        cpus = os.cpu_count() or 1
+    limit = cgroup_cpu_limit()
+    if limit > 0:
+        cpus = min(cpus, limit)
+    return max(cpus, 1)
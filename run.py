@@ -1,187 +1,352 @@
 import os
 import argparse
+import copy
+import shlex
 import sys
 import time
 import subprocess
 from subprocess import Popen, PIPE
+from checkpoint import Checkpoint
+from scheduler import Stage, Sample, Scheduler
+from profiling import Profile
+from resources import available_cpus
+from compression import file_compression, compressor
 
 
 def cmd_exists(cmd):
     return subprocess.call("type " + cmd, shell=True,
         stdout=subprocess.PIPE, stderr=subprocess.PIPE) == 0
 
-def main():
-    cwd=os.path.dirname(os.path.abspath(__file__))
+def resources(args,cores=1):
+    # --threads and --max-memory of the C++ tools. cores is what the stage reserves from the
+    # scheduler, the memory budget holds for each stage on its own.
+    flags = ' -t '+str(cores)
+    if args.max_memory:
+        flags += ' -M '+args.max_memory
+    return flags
 
-    parser = argparse.ArgumentParser(description="MetaCarvel: A scaffolding tool for metagenomic assemblies")
-    parser.add_argument("-a","--assembly",help="assembled contigs",required=True)
-    parser.add_argument("-m","--mapping", help="mapping of read to contigs in bam format",required=True)
-    parser.add_argument("-d","--dir",help="output directory for results",default='out',required=True)
-    parser.add_argument("-r",'--repeats',help="To turn repeat detection on",default="true")
-    parser.add_argument("-k","--keep", help="Set this to keep temporary files in output directory",default=False)
-    parser.add_argument("-l","--length",help="Minimum length of contigs to consider for scaffolding in base pairs (bp)",default=500)
-    parser.add_argument("-b","--bsize",help="Minimum mate pair support between contigs to consider for scaffolding",default=3)
-    parser.add_argument("-v",'--visualization',help="Generate a .db file for the MetagenomeScope visualization tool",default=False)
+def alignment_beds(args):
+    # a single alignment.bed, or one per mate when the mates were mapped separately
+    if len(args.mapping.split(',')) == 2:
+        return [args.dir+'/alignment_1.bed'+args.zext,args.dir+'/alignment_2.bed'+args.zext]
+    return [args.dir+'/alignment.bed'+args.zext]
 
-    args = parser.parse_args()
-    try:
-      import networkx
-    except ImportError:
-      raise ImportError('Looks like you do not have networkx. Please rerun with networkx module installed.')
-      sys.exit(1)
-    version = networkx.__version__
-    version_id = int(version.split('.')[1])
-    first = int(version.split('.')[0])
-    print('Networkx ' + version + ' found', file=sys.stderr)
-   # if first != 1:
-   #    print(time.strftime("%c")+': Networkx should be 1.11 or earlier.. Terminating...\n', file=sys.stderr)
-   #    sys.exit(1)
-    if not cmd_exists('samtools'):
-      print(time.strftime("%c")+': Samtools does not exist in PATH. Terminating....\n', file=sys.stderr)
-      sys.exit(1)
+def alignment_options(args):
+    beds = alignment_beds(args)
+    if len(beds) == 2:
+        options = '-1 '+beds[0]+' -2 '+beds[1]
+    elif args.prefilter == "true":
+        options = '-a '+beds[0]+' --prefilter'
+    else:
+        options = '-a '+beds[0]
+    if args.dedup == "true":
+        options += ' --dedup'
+    if args.max_links > 0:
+        options += ' --max_links '+str(args.max_links)
+    if args.end_proximity > 0:
+        options += ' -e '+str(args.end_proximity)
+    return options
 
-    if not cmd_exists('bamToBed'):
-      print(time.strftime("%c")+': Bedtools does not exist in PATH. Terminating....\n', file=sys.stderr)
-      sys.exit(1)
+def binned_options(args):
+    if args.binned > 0:
+        return ' --binned '+str(args.binned)+' --bin_width '+str(args.bin_width)
+    return ''
 
-    if not os.path.exists(args.dir):
-        os.makedirs(args.dir)
-    print(time.strftime("%c")+':Starting scaffolding..', file=sys.stderr)
+def spectral_option(args):
+    # contigs are oriented by a BFS preferring large bundles unless this is set
+    if args.spectral == "true":
+        return ' --spectral'
+    return ''
 
+def acyclic_option(args):
+    # cycles left after orientation are broken by invalidating a light feedback arc set
+    if args.acyclic == "true":
+        return ' --acyclic'
+    return ''
 
-    if os.path.exists(args.dir+'/alignment.bed') == False:
-        print("converting bam file to bed file", file=sys.stderr)
-        #os.system('bamToBed -i ' + args.mapping + " > " + args.dir+'/alignment.bed')
-        try:
-          p = subprocess.check_output('bamToBed -i ' + args.mapping + " > " + args.dir+'/alignment.bed', shell=True)
-          print('finished conversion', file=sys.stderr)
-        except subprocess.CalledProcessError as err:
-          os.system("rm " + args.dir+'/alignment.bed')
-          print(time.strftime("%c")+': Failed in coverting bam file to bed format, terminating scaffolding....\n' + str(err.output), file=sys.stderr)
-          sys.exit(1)
-    try:
-      #os.system('samtools faidx '+args.assembly)
-      p = subprocess.check_output('samtools faidx '+args.assembly,shell=True)
-    except subprocess.CalledProcessError as err:
-      print(str(err.output), file=sys.stderr)
-      sys.exit()
-    os.system('cut -f 1,2 '+ args.assembly+'.fai > '+args.dir+'/contig_length')
-
-    print(time.strftime("%c")+':Finished conversion', file=sys.stderr)
-
-    final_assembly = args.assembly
-    final_mapping = args.mapping
-
-    print(time.strftime("%c") + ':Started generating links between contigs', file=sys.stderr)
-    if os.path.exists(args.dir+'/contig_links') == False:
-        #print './libcorrect -l' + args.lib + ' -a' + args.dir+'/alignment.bed -d ' +args.dir+'/contig_length -o '+ args.dir+'/contig_links'
-        try:
-          #os.system('./libcorrect -l ' + args.lib + ' -a ' + args.dir+'/alignment.bed -d ' +args.dir+'/contig_length -o '+ args.dir+'/contig_links -x '+args.dir+'/contig_coverage')
-           p = subprocess.check_output(cwd+'/libcorrect -a ' + args.dir+'/alignment.bed -d ' +args.dir+'/contig_length -o '+ args.dir+'/contig_links -x '+args.dir+'/contig_coverage -c '+str(args.length),shell=True)
-           print(time.strftime("%c") +':Finished generating links between contigs', file=sys.stderr)
-        except subprocess.CalledProcessError as err:
-            os.system('rm '+args.dir+'/contig_links')
-            print(time.strftime("%c")+': Failed in generate links from bed file, terminating scaffolding....\n' + str(err.output), file=sys.stderr)
-            sys.exit(1)
+def bubble_option(args):
+    # superbubbles instead of the separation pairs of the SPQR trees
+    if args.superbubbles == "true":
+        return ' --superbubbles'
+    return ''
+
+def budget_options(args):
+    # biconnected components over these budgets only get their cut vertex pair in seppairs
+    options = ''
+    if args.spqr_max_edges > 0:
+        options += ' --max_component_edges '+str(args.spqr_max_edges)
+    if args.spqr_seconds > 0:
+        options += ' --max_component_seconds '+str(args.spqr_seconds)
+    return options
+
+def budget_params(args):
+    return {'spqr_max_edges':args.spqr_max_edges,'spqr_seconds':args.spqr_seconds}
 
-    print(time.strftime("%c")+':Started bulding of links between contigs', file=sys.stderr)
-    if os.path.exists(args.dir+'/bundled_links') == False:
-        try:
-          #os.system('./bundler -l '+ args.dir+'/contig_links -o ' + args.dir+'/bundled_links + -b '+args.dir+'/bundled_graph.gml')
-          p = subprocess.check_output(cwd+'/bundler -l '+ args.dir+'/contig_links -o ' + args.dir+'/bundled_links + -b '+args.dir+'/bundled_graph.gml -c '+str(args.bsize), shell=True)
-          print(time.strftime("%c")+':Finished bundling of links between contigs', file=sys.stderr)
-        except subprocess.CalledProcessError as err:
-          os.system('rm '+args.dir+'/bundled_links')
-          os.system('rm '+args.dir+'/bundled_graph.gml')
-          print(time.strftime("%c")+': Failed to bundle links, terminating scaffolding....\n' + str(err.output), file=sys.stderr)
-          sys.exit(1)
+def link_params(args):
+    # options that change the links, so that changing them reruns link generation
+    return {'length':args.length,'end_proximity':args.end_proximity,'dedup':args.dedup,'max_links':args.max_links}
 
+def bundle_params(args):
+    return {'bsize':args.bsize,'binned':args.binned,'bin_width':args.bin_width}
+
+def filter_repeats(args,cwd,scheduler):
+    # expects the bundled_links.img graph image and invalidated_counts_unfiltered from the first
+    # orientation pass
+    scheduler.add(Stage('centrality','python '+cwd+'/centrality.py  -g '+args.dir+'/bundled_links.img -l ' + args.dir+ '/contig_length -o  '+args.dir+'/high_centrality.txt -t '+str(args.threads),
+        [args.dir+'/bundled_links.img',args.dir+'/contig_length'],[args.dir+'/high_centrality.txt'],cores=args.threads,
+        fail=' Failed to find repeats, terminating scaffolding....'))
+    scheduler.add(Stage('repeat_filter','python '+cwd+'/repeat_filter.py  '+args.dir+'/contig_coverage ' + args.dir+ '/bundled_links.img ' + args.dir+'/invalidated_counts_unfiltered ' + args.dir+'/high_centrality.txt ' + args.dir+ '/contig_length '+ args.dir+'/repeats > ' + args.dir+'/bundled_links_filtered',
+        [args.dir+'/contig_coverage',args.dir+'/bundled_links.img',args.dir+'/invalidated_counts_unfiltered',args.dir+'/high_centrality.txt',args.dir+'/contig_length'],
+        [args.dir+'/repeats',args.dir+'/bundled_links_filtered'],
+        done='Finished repeat finding and removal',fail=' Failed to find repeats, terminating scaffolding....'))
+
+def run_driver(args,cwd,scheduler):
+    # libcorrect, bundler, orientcontigs and spqr in one metacarvel process, links stay in memory.
+    # With repeat detection the driver stops after the first orientation pass and is restarted on
+    # the filtered links.
+    keep = ''
+    if args.keep == "true":
+        keep = ' -k'
+    gml = []
+    if args.visualization == "true":
+        keep += ' -g'
+        gml = [args.dir+'/oriented.gml']
+    params = dict(link_params(args),**bundle_params(args))
+    params.update({'keep':args.keep,'visualization':args.visualization,'spectral':args.spectral,'acyclic':args.acyclic,'superbubbles':args.superbubbles})
+    params.update(budget_params(args))
+    inputs = alignment_beds(args)+[args.dir+'/contig_length']
     if args.repeats == "true":
-        print(time.strftime("%c")+':Started finding and removing repeats', file=sys.stderr)
-        try:
-            p = subprocess.check_output(cwd+'/orientcontigs -l '+args.dir+'/bundled_links -c '+ args.dir+'/contig_length --bsize -o ' +args.dir+'/oriented.gml -p ' + args.dir+'/oriented_links -i '+args.dir+'/invalidated_counts',shell=True)
+        scheduler.add(Stage('metacarvel_repeats',cwd+'/metacarvel '+alignment_options(args)+' -d ' +args.dir+'/contig_length -o '+ args.dir+' -c '+str(args.length)+' -b '+str(args.bsize)+binned_options(args)+' -r'+keep+spectral_option(args)+resources(args,args.threads),
+            inputs,[args.dir+'/contig_coverage',args.dir+'/bundled_links.img',args.dir+'/invalidated_counts_unfiltered'],params,cores=args.threads,
+            start='Started scaffolding in a single process',fail=' Failed to scaffold contigs, terminating scaffolding....'))
+        filter_repeats(args,cwd,scheduler)
+        scheduler.add(Stage('metacarvel_filtered',cwd+'/metacarvel -l ' + args.dir+'/bundled_links_filtered -d ' +args.dir+'/contig_length -o '+ args.dir+keep+spectral_option(args)+acyclic_option(args)+bubble_option(args)+budget_options(args)+resources(args,args.threads),
+            [args.dir+'/bundled_links_filtered',args.dir+'/contig_length'],[args.dir+'/oriented.img',args.dir+'/seppairs']+gml,dict({'keep':args.keep,'visualization':args.visualization,'spectral':args.spectral,'acyclic':args.acyclic,'superbubbles':args.superbubbles},**budget_params(args)),cores=args.threads,
+            done='Finished finding spearation pairs',fail=' Failed to scaffold contigs, terminating scaffolding....'))
+    else:
+        scheduler.add(Stage('metacarvel',cwd+'/metacarvel '+alignment_options(args)+' -d ' +args.dir+'/contig_length -o '+ args.dir+' -c '+str(args.length)+' -b '+str(args.bsize)+binned_options(args)+keep+spectral_option(args)+acyclic_option(args)+bubble_option(args)+budget_options(args)+resources(args,args.threads),
+            inputs,[args.dir+'/contig_coverage',args.dir+'/oriented.img',args.dir+'/seppairs']+gml,params,cores=args.threads,
+            start='Started scaffolding in a single process',done='Finished finding spearation pairs',fail=' Failed to scaffold contigs, terminating scaffolding....'))
 
-        except subprocess.CalledProcessError as err:
-            print(time.strftime("%c") + ': Failed to find repeats, terminating scaffolding...\n' + str(err.output), file=sys.stderr)
+def run_stages(args,cwd,scheduler):
+    scheduler.add(Stage('libcorrect',cwd+'/libcorrect '+alignment_options(args)+' -d ' +args.dir+'/contig_length -o '+ args.dir+'/contig_links'+args.zext+' -x '+args.dir+'/contig_coverage -c '+str(args.length)+resources(args),
+        alignment_beds(args)+[args.dir+'/contig_length'],[args.dir+'/contig_links'+args.zext,args.dir+'/contig_coverage'],link_params(args),
+        start='Started generating links between contigs',done='Finished generating links between contigs',
+        fail=' Failed in generate links from bed file, terminating scaffolding....',cleanup=[args.dir+'/contig_links'+args.zext]))
+    scheduler.add(Stage('bundler',cwd+'/bundler -l '+ args.dir+'/contig_links'+args.zext+' -o ' + args.dir+'/bundled_links + -b '+args.dir+'/bundled_graph.gml -c '+str(args.bsize)+binned_options(args)+' -i '+args.dir+'/bundled_links.img'+resources(args,args.threads),
+        [args.dir+'/contig_links'+args.zext],[args.dir+'/bundled_links',args.dir+'/bundled_graph.gml',args.dir+'/bundled_links.img'],bundle_params(args),cores=args.threads,
+        start='Started bulding of links between contigs',done='Finished bundling of links between contigs',
+        fail=' Failed to bundle links, terminating scaffolding....',cleanup=[args.dir+'/bundled_links',args.dir+'/bundled_graph.gml',args.dir+'/bundled_links.img']))
 
-        try:
-            p = subprocess.check_output('python '+cwd+'/centrality.py  -g '+args.dir+'/bundled_links -l ' + args.dir+ '/contig_length -o  '+args.dir+'/high_centrality.txt' ,shell=True)
-        except subprocess.CalledProcessError as err:
-                print(time.strftime("%c")+': Failed to find repeats, terminating scaffolding....\n' + str(err.output), file=sys.stderr)
-                sys.exit(1)
+    # the repeat finding pass writes its own *_unfiltered outputs so a resumed run can tell them
+    # apart from the final orientation. It only reads bundled_links, like centrality.py, so the two
+    # run side by side.
+    oriented_input = args.dir+'/bundled_links'
+    if args.repeats == "true":
+        scheduler.add(Stage('orientcontigs_unfiltered',cwd+'/orientcontigs -l '+args.dir+'/bundled_links -c '+ args.dir+'/contig_length'+(spectral_option(args) or ' --bsize')+' -o ' +args.dir+'/oriented_unfiltered.gml -p ' + args.dir+'/oriented_links_unfiltered -i '+args.dir+'/invalidated_counts_unfiltered'+resources(args),
+            [args.dir+'/bundled_links',args.dir+'/contig_length'],[args.dir+'/oriented_unfiltered.gml',args.dir+'/oriented_links_unfiltered',args.dir+'/invalidated_counts_unfiltered'],{'spectral':args.spectral},
+            start='Started finding and removing repeats',fail=' Failed to find repeats, terminating scaffolding...',fatal=False))
+        filter_repeats(args,cwd,scheduler)
+        oriented_input = args.dir+'/bundled_links_filtered'
+    # later stages read the oriented.img snapshot, the GML export is only written for --keep and
+    # for MetagenomeScope
+    gml = ''
+    outputs = [args.dir+'/oriented.img',args.dir+'/oriented_links',args.dir+'/invalidated_counts']
+    if args.keep == "true" or args.visualization == "true":
+        gml = ' -o '+args.dir+'/oriented.gml'
+        outputs.append(args.dir+'/oriented.gml')
+    scheduler.add(Stage('orientcontigs',cwd+'/orientcontigs -l '+oriented_input+' -c '+ args.dir+'/contig_length'+(spectral_option(args) or ' --bsize')+acyclic_option(args)+' -s ' +args.dir+'/oriented.img'+gml+' -p ' + args.dir+'/oriented_links -i '+args.dir+'/invalidated_counts'+resources(args),
+        [oriented_input,args.dir+'/contig_length'],outputs,{'spectral':args.spectral,'acyclic':args.acyclic},
+        start='Started orienting the contigs',done='Finished orienting the contigs',
+        fail=' Failed to Orient contigs, terminating scaffolding....',fatal=False))
+    scheduler.add(Stage('spqr',cwd+'/spqr -l ' + args.dir+'/oriented_links -o ' + args.dir+'/seppairs'+bubble_option(args)+budget_options(args)+resources(args),
+        [args.dir+'/oriented_links'],[args.dir+'/seppairs'],dict({'superbubbles':args.superbubbles},**budget_params(args)),
+        start='Started finding separation pairs',done='Finished finding spearation pairs',
+        fail=' Failed to decompose graph, terminating scaffolding....'))
 
-        try:
-            p = subprocess.check_output('python '+cwd+'/repeat_filter.py  '+args.dir+'/contig_coverage ' + args.dir+ '/bundled_links ' + args.dir+'//invalidated_counts ' + args.dir+'/high_centrality.txt ' + args.dir+ '/contig_length '+ args.dir+'/repeats > ' + args.dir+'//bundled_links_filtered',shell=True)
-        except subprocess.CalledProcessError as err:
-            print(time.strftime("%c")+': Failed to find repeats, terminating scaffolding....\n' + str(err.output), file=sys.stderr)
-            sys.exit(1)
-        print(time.strftime("%c")+':Finished repeat finding and removal', file=sys.stderr)
+def add_sample(args,cwd,scheduler,name=''):
+    # declares the stages of one sample, writing to args.dir.
+    # stages are skipped when checkpoint.json in the output directory shows they already ran with
+    # the same parameters on the same inputs. Time, memory and I/O of every stage go to profile.json.
+    if not os.path.exists(args.dir):
+        os.makedirs(args.dir)
+    scheduler.add_sample(Sample(name,Checkpoint(args.dir),Profile(args.dir+'/profile.json')))
+
+    # with --compress the large intermediates, alignment.bed and contig_links, are written compressed.
+    # Mates mapped separately as single end reads are converted one file each and joined by
+    # libcorrect, without merging and name sorting the BAM files.
+    mappings = args.mapping.split(',')
+    beds = alignment_beds(args)
+    for i in range(len(beds)):
+        bamtobed = 'bamToBed -i ' + mappings[i] + " > " + beds[i]
+        if args.compress:
+            bamtobed = 'bash -o pipefail -c '+shlex.quote('bamToBed -i ' + mappings[i] + ' | ' + compressor(args.compress,args.threads) + ' > ' + beds[i])
+        scheduler.add(Stage('bamToBed' if len(beds) == 1 else 'bamToBed_'+str(i+1),bamtobed,
+            [mappings[i]],[beds[i]],
+            start='converting bam file to bed file',done='finished conversion',
+            fail=' Failed in coverting bam file to bed format, terminating scaffolding....',cleanup=[beds[i]]))
+    # samtools only indexes plain and bgzip compressed FASTA, compressed assemblies are measured as they stream by.
+    # The index goes to the sample directory, batch samples sharing an assembly would race writing it next to the assembly.
+    contig_length = 'samtools faidx --fai-idx '+args.dir+'/assembly.fai '+args.assembly+' && cut -f 1,2 '+ args.dir+'/assembly.fai > '+args.dir+'/contig_length'
+    if os.path.exists(args.assembly) and file_compression(args.assembly):
+        decompress = 'zstd -dcq ' if file_compression(args.assembly) == 'zst' else 'gzip -dc '
+        contig_length = 'bash -o pipefail -c '+shlex.quote(decompress+args.assembly+' | awk \'/^>/ {if(n) print n"\\t"l; n=substr($1,2); l=0; next} {l+=length($0)} END {if(n) print n"\\t"l}\' > '+args.dir+'/contig_length')
+    scheduler.add(Stage('contig_length',contig_length,
+        [args.assembly],[args.dir+'/contig_length'],fail=' Failed to index the assembly, terminating scaffolding....'))
+
+    if args.driver == "true":
+        run_driver(args,cwd,scheduler)
     else:
-        os.system('mv '+args.dir+'/bundled_links ' + args.dir+'/bundled_links_filtered')
-    print(time.strftime("%c")+':Started orienting the contigs', file=sys.stderr)
-    # if os.path.exists(args.dir+'/oriented_links') == False:
-      #os.system('./orientcontigs -l '+args.dir+'/bundled_links_filtered -c '+ args.dir+'/contig_length --bsize -o ' +args.dir+'/oriented.gml -p ' + args.dir+'/oriented_links' )
-    try:
-        p = subprocess.check_output(cwd+'/orientcontigs -l '+args.dir+'/bundled_links_filtered -c '+ args.dir+'/contig_length --bsize -o ' +args.dir+'/oriented.gml -p ' + args.dir+'/oriented_links -i '+args.dir+'/invalidated_counts',shell=True)
-        print(time.strftime("%c")+':Finished orienting the contigs', file=sys.stderr)
-    except subprocess.CalledProcessError:
-        print(time.strftime("%c")+': Failed to Orient contigs, terminating scaffolding....', file=sys.stderr)
-
-    print(time.strftime("%c")+':Started finding separation pairs', file=sys.stderr)
-    #if os.path.exists(args.dir+'/seppairs') == False:
-    #os.system('./spqr -l ' + args.dir+'/oriented_links -o ' + args.dir+'/seppairs')
-    try:
-        p = subprocess.check_output(cwd+'/spqr -l ' + args.dir+'/oriented_links -o ' + args.dir+'/seppairs',shell=True)
-        print(time.strftime("%c")+':Finished finding spearation pairs', file=sys.stderr)
-    except subprocess.CalledProcessError as err:
-        print(time.strftime("%c")+': Failed to decompose graph, terminating scaffolding....\n' + str(err.output), file=sys.stderr)
-        sys.exit(1)
+        run_stages(args,cwd,scheduler)
 
-    print(time.strftime("%c")+':Finding the layout of contigs', file=sys.stderr)
-    if os.path.exists(args.dir+'/scaffolds.fasta') == False:
-        try:
-            p = subprocess.check_output('python '+cwd+'/layout.py -a '+ args.assembly +' -b '+args.dir+'/bubbles.txt' +' -g ' + args.dir+'/oriented.gml -s '+args.dir+'/seppairs -o '+args.dir+'/scaffolds.fa -f '+args.dir+'/scaffolds.agp -e '+args.dir+'/scaffold_graph.gfa',shell=True)
-            print(time.strftime("%c")+':Final scaffolds written, Done!', file=sys.stderr)
-        except subprocess.CalledProcessError as err:
-            print(time.strftime("%c")+': Failed to generate scaffold sequences, terminating scaffolding....\n' + str(err.output), file=sys.stderr)
+    scheduler.add(Stage('layout','python '+cwd+'/layout.py -a '+ args.assembly +' -b '+args.dir+'/bubbles.txt' +' -g ' + args.dir+'/oriented.img -s '+args.dir+'/seppairs -o '+args.dir+'/scaffolds.fa -f '+args.dir+'/scaffolds.agp -e '+args.dir+'/scaffold_graph.gfa',
+        [args.assembly,args.dir+'/oriented.img',args.dir+'/seppairs'],[args.dir+'/scaffolds.fa',args.dir+'/scaffolds.agp',args.dir+'/scaffold_graph.gfa',args.dir+'/bubbles.txt'],
+        start='Finding the layout of contigs',done='Final scaffolds written, Done!',
+        fail=' Failed to generate scaffold sequences, terminating scaffolding....',fatal=False))
 
     if args.visualization == "true":
-        #try:
-      graphpath = os.path.abspath(args.dir+'/oriented.gml')
-      bubblepath = os.path.abspath(args.dir+'/bubbles.txt')
       # Output the MetagenomeScope .db file directly to args.dir. The only file
       # created by collate.py here is the mgsc.db file.
-      os.system('python '+cwd+'/MetagenomeScope/graph_collator/collate.py -i '
+      graphpath = os.path.abspath(args.dir+'/oriented.gml')
+      bubblepath = os.path.abspath(args.dir+'/bubbles.txt')
+      scheduler.add(Stage('visualization','python '+cwd+'/MetagenomeScope/graph_collator/collate.py -i '
               + graphpath + ' -w -ub ' + bubblepath + ' -ubl -d ' + args.dir
-              + ' -o mgsc')
-          #p = subprocess.check_output('python '+cwd+'/MetagenomeScope/graph_collator/collate.py -i ' + graphpath + ' -w -ub ' + bubblepath + ' -ubl -d ' + args.dir + ' -o mgsc')
-        #except subprocess.CalledProcessError as err:
-            #print >> sys.stderr, time.strftime("%c")+": Failed to run MetagenomeScope \n" + str(err.output)
+              + ' -o mgsc',[graphpath,bubblepath],[args.dir+'/mgsc.db'],
+              fail=" Failed to run MetagenomeScope",fatal=False))
 
+def cleanup(args):
+    # removes the intermediate files unless --keep is set
     if not args.keep == "true":
       if os.path.exists(args.dir+'/contig_length'):
        os.system("rm "+args.dir+'/contig_length')
-      if os.path.exists(args.dir+'/contig_links'):
-       os.system("rm "+args.dir+'/contig_links')
+      if os.path.exists(args.dir+'/assembly.fai'):
+       os.system("rm "+args.dir+'/assembly.fai')
+      if os.path.exists(args.dir+'/contig_links'+args.zext):
+       os.system("rm "+args.dir+'/contig_links'+args.zext)
       if os.path.exists(args.dir+'/contig_coverage'):
         os.system("rm "+args.dir+'/contig_coverage')
       if os.path.exists(args.dir+'/bundled_links'):
         os.system("rm "+args.dir+'/bundled_links')
+      if os.path.exists(args.dir+'/bundled_links.img'):
+        os.system("rm "+args.dir+'/bundled_links.img')
       if os.path.exists(args.dir+'/bundled_links_filtered'):
         os.system("rm "+args.dir+'/bundled_links_filtered')
       if os.path.exists(args.dir+'/bundled_graph.gml'):
         os.system("rm "+args.dir+'/bundled_graph.gml')
       if os.path.exists(args.dir+'/invalidated_counts'):
         os.system("rm "+args.dir+'/invalidated_counts')
+      if os.path.exists(args.dir+'/invalidated_counts_unfiltered'):
+        os.system("rm "+args.dir+'/invalidated_counts_unfiltered')
+      if os.path.exists(args.dir+'/oriented_links_unfiltered'):
+        os.system("rm "+args.dir+'/oriented_links_unfiltered')
+      if os.path.exists(args.dir+'/oriented_unfiltered.gml'):
+        os.system("rm "+args.dir+'/oriented_unfiltered.gml')
       if os.path.exists(args.dir+'/repeats'):
         os.system("rm "+args.dir+'/repeats')
       if os.path.exists(args.dir+'/oriented_links'):
         os.system("rm "+args.dir+'/oriented_links')
       if os.path.exists(args.dir+'/oriented.gml'):
         os.system("rm "+args.dir+'/oriented.gml')
+      if os.path.exists(args.dir+'/oriented.img'):
+        os.system("rm "+args.dir+'/oriented.img')
       if os.path.exists(args.dir+'/seppairs'):
         os.system("rm "+args.dir+'/seppairs')
-      if os.path.exists(args.dir+'/alignment.bed'):
-        os.system("rm "+args.dir+'/alignment.bed')
+      for bed in alignment_beds(args):
+        if os.path.exists(bed):
+          os.system("rm "+bed)
+def main():
+    cwd=os.path.dirname(os.path.abspath(__file__))
+
+    parser = argparse.ArgumentParser(description="MetaCarvel: A scaffolding tool for metagenomic assemblies")
+    parser.add_argument("-a","--assembly",help="assembled contigs")
+    parser.add_argument("-m","--mapping", help="mapping of read to contigs in bam format, or two comma separated files for mates mapped separately as single end reads")
+    parser.add_argument("-d","--dir",help="output directory for results",default='out',required=True)
+    parser.add_argument("-r",'--repeats',help="To turn repeat detection on",default="true")
+    parser.add_argument("-k","--keep", help="Set this to keep temporary files in output directory",default=False)
+    parser.add_argument("-l","--length",help="Minimum length of contigs to consider for scaffolding in base pairs (bp)",default=500)
+    parser.add_argument("-b","--bsize",help="Minimum mate pair support between contigs to consider for scaffolding",default=3)
+    parser.add_argument("-v",'--visualization',help="Generate a .db file for the MetagenomeScope visualization tool",default=False)
+    parser.add_argument('--driver',help="Set this to run the C++ stages in a single metacarvel process, keeping links in memory",default=False)
+    parser.add_argument("-t","--threads",help="Number of cores shared by the stages that run concurrently",type=int,default=available_cpus())
+    parser.add_argument("-M","--max-memory",help="Memory budget of each stage, such as 16G. Stages that would need more spill to disk. Defaults to the cgroup memory limit")
+    parser.add_argument('-e','--end_proximity',help="Drop read pairs implying a gap below -K stdev of the insert size, whose reads lie too far from the contig ends (default: 0, keep all)",type=float,default=0)
+    parser.add_argument('--dedup',help="Set this to collapse read pairs aligned to the same positions, PCR and optical duplicates, into a single link",default=False)
+    parser.add_argument('--max_links',help="Keep a random sample of at most this many links per contig pair and orientation, bundles still count every read pair (default: 0, keep all)",type=int,default=0)
+    parser.add_argument('--binned',help="Bundle contig pairs with more than this many links approximately, on a histogram of the link intervals (default: 0, all exactly)",type=int,default=0)
+    parser.add_argument('--bin_width',help="Histogram bin width in bp for --binned, bundled links are within this distance of overlapping (default: 10)",type=float,default=10)
+    parser.add_argument('--spectral',help="Set this to orient contigs by the leading eigenvector of the signed link matrix instead of a greedy BFS",default=False)
+    parser.add_argument('--acyclic',help="Set this to also invalidate a light set of links closing cycles, leaving the oriented graph acyclic",default=False)
+    parser.add_argument('--superbubbles',help="Set this to find bubbles as superbubbles of the oriented graph, in linear time, instead of from its SPQR trees",default=False)
+    parser.add_argument('--spqr_max_edges',help="Write only the cut vertex pair of biconnected components with more links than this, instead of decomposing them into SPQR trees (default: 0, no limit)",type=int,default=0)
+    parser.add_argument('--spqr_seconds',help="Give up decomposing a biconnected component after this many seconds and write only its cut vertex pair (default: 0, no limit)",type=float,default=0)
+    parser.add_argument('--prefilter',help="Set this to read the alignments twice, first counting read names, so that reads whose mate is not aligned are never stored",default=False)
+    parser.add_argument("-z","--compress",help="Write the large intermediate files compressed, with gz or zst. Compressed inputs are recognised on their own",choices=['gz','zst'],default=None)
+    parser.add_argument('--batch',help="File listing one sample per line: name, assembly and mapping. Each sample is scaffolded into DIR/name, all of them sharing --threads")
+
+    args = parser.parse_args()
+    if args.batch is None and (args.assembly is None or args.mapping is None):
+        parser.error('the following arguments are required: -a/--assembly, -m/--mapping')
+    # file name extension of the compressed intermediates
+    args.zext = '.'+args.compress if args.compress else ''
+    try:
+      import networkx
+    except ImportError:
+      raise ImportError('Looks like you do not have networkx. Please rerun with networkx module installed.')
+      sys.exit(1)
+    version = networkx.__version__
+    version_id = int(version.split('.')[1])
+    first = int(version.split('.')[0])
+    print('Networkx ' + version + ' found', file=sys.stderr)
+   # if first != 1:
+   #    print(time.strftime("%c")+': Networkx should be 1.11 or earlier.. Terminating...\n', file=sys.stderr)
+   #    sys.exit(1)
+    if not cmd_exists('samtools'):
+      print(time.strftime("%c")+': Samtools does not exist in PATH. Terminating....\n', file=sys.stderr)
+      sys.exit(1)
+
+    if not cmd_exists('bamToBed'):
+      print(time.strftime("%c")+': Bedtools does not exist in PATH. Terminating....\n', file=sys.stderr)
+      sys.exit(1)
+
+    print(time.strftime("%c")+':Starting scaffolding..', file=sys.stderr)
+
+    # independent stages run concurrently within --threads, in batch mode across all samples
+    if args.batch is None:
+        scheduler = Scheduler(args.threads)
+        add_sample(args,cwd,scheduler)
+        ok = scheduler.run()
+        cleanup(args)
+        if not ok:
+            # a non-fatal stage failed and the stages depending on it were skipped
+            print(time.strftime("%c")+': Scaffolding did not complete, see the failed stages above', file=sys.stderr)
+            sys.exit(1)
+        return
+
+    samples = []
+    with open(args.batch,'r') as f:
+        for line in f:
+            val = line.split()
+            if len(val) == 0 or val[0].startswith('#'):
+                continue
+            if len(val) < 3:
+                print(time.strftime("%c")+': Expected sample name, assembly and mapping in the batch file, got '+line.strip()+'. Terminating....\n', file=sys.stderr)
+                sys.exit(1)
+            sample = copy.copy(args)
+            sample.assembly = val[1]
+            sample.mapping = val[2]
+            sample.dir = os.path.join(args.dir,val[0])
+            samples.append((val[0],sample))
+    scheduler = Scheduler(args.threads,keep_going=True)
+    for name,sample in samples:
+        add_sample(sample,cwd,scheduler,name)
+    ok = scheduler.run()
+    for name,sample in samples:
+        cleanup(sample)
+    failed = [s.name for s in scheduler.samples if s.failed]
+    if failed:
+        print(time.strftime("%c")+': Scaffolding failed for '+', '.join(failed), file=sys.stderr)
+    if failed or not ok:
+        sys.exit(1)
+
 if __name__ == '__main__':
     main()
@@ -0,0 +1,206 @@
+import os
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+'''
+Runs pipeline stages as a dependency graph.
+
+A stage depends on the stages that write its input files, so the graph follows from the file names
+alone. Stages whose dependencies are done are started as soon as enough of the core budget is free
+(a stage wider than the whole budget runs alone), in the order they were added. Stages that the
+checkpoint shows as up to date are not run at all.
+
+Stages belong to a sample, which holds the checkpoint and profile of one output directory. In batch
+mode several samples share the scheduler, so serial stages of one sample fill the cores left over
+by the others, and a fatal failure ends only the sample it happened in.
+'''
+class Stage:
+    def __init__(self, name, cmd, inputs, outputs, params={}, cores=1, start=None, done=None, fail=None, fatal=True, cleanup=[]):
+        self.name = name
+        self.cmd = cmd
+        self.inputs = inputs
+        self.outputs = outputs
+        self.params = params
+        self.cores = cores
+        self.start = start          # messages printed when the stage starts, succeeds and fails
+        self.done = done
+        self.fail = fail
+        self.fatal = fatal          # a fatal failure stops the sample
+        self.cleanup = cleanup      # files removed when the stage fails
+        self.sample = None
+        self.index = None
+
+class Sample:
+    def __init__(self, name, checkpoint, profile=None):
+        self.name = name
+        self.checkpoint = checkpoint
+        self.profile = profile
+        self.failed = False
+
+class Scheduler:
+    def __init__(self, cores, keep_going=False):
+        self.cores = max(1, int(cores))
+        self.keep_going = keep_going    # with several samples, go on after one of them failed
+        self.stages = []
+        self.samples = []
+        self.running = {}
+
+    def add_sample(self, sample):
+        # stages added from now on belong to sample
+        self.samples.append(sample)
+        return sample
+
+    def add(self, stage):
+        stage.sample = self.samples[-1]
+        stage.index = len(self.stages)
+        self.stages.append(stage)
+        return stage
+
+    def dependencies(self):
+        producer = {}
+        for i, stage in enumerate(self.stages):
+            for path in stage.outputs:
+                producer[os.path.abspath(path)] = i
+        deps = []
+        for i, stage in enumerate(self.stages):
+            deps.append(set(producer[os.path.abspath(path)] for path in stage.inputs
+                            if os.path.abspath(path) in producer and producer[os.path.abspath(path)] != i))
+        return deps
+
+    def log(self, stage, message):
+        if message is None:
+            return
+        if stage.sample.name:
+            message = stage.sample.name+': '+message.lstrip()
+        print(time.strftime("%c")+':'+message, file=sys.stderr)
+
+    def launch(self, stage):
+        self.log(stage, stage.start)
+        stage.sample.checkpoint.invalidate(stage.name)
+        output = tempfile.TemporaryFile()
+        # a session of its own, so that stopping the stage kills the commands its shell started too
+        p = subprocess.Popen(stage.cmd, shell=True, stdout=output, start_new_session=True)
+        return (stage, p, output, time.time())
+
+    def finished(self, job, status, rusage):
+        stage, p, output, started = job
+        p.returncode = status
+        if stage.sample.profile is not None:
+            stage.sample.profile.finished(stage, status, time.time() - started, rusage)
+        if status == 0:
+            stage.sample.checkpoint.record(stage.name, stage.inputs, stage.outputs, stage.params)
+            self.log(stage, stage.done)
+            return True
+        output.seek(0)
+        for path in stage.cleanup:
+            if os.path.exists(path):
+                os.remove(path)
+        self.log(stage, (stage.fail or ' '+stage.name+' failed')+'\n'+str(output.read()))
+        return False
+
+    def skipped(self, stage, status):
+        if stage.sample.profile is not None:
+            stage.sample.profile.skipped(stage, status)
+
+    def save(self):
+        for sample in self.samples:
+            if sample.profile is not None:
+                sample.profile.save()
+
+    def stop(self, running, sample=None):
+        # kills the running stages of sample, or all of them, and returns them
+        stopped = []
+        for pid in list(running):
+            stage, p, output, started = running[pid]
+            if sample is None or stage.sample is sample:
+                try:
+                    os.killpg(p.pid, signal.SIGKILL)
+                except ProcessLookupError:
+                    pass
+                p.wait()
+                del running[pid]
+                self.skipped(stage, 'killed')
+                stopped.append(stage)
+        return stopped
+
+    def wait(self, running):
+        # pid of a finished stage, left to be reaped. Other children, like the decompressors the
+        # profile counts records with, are reaped by their owners, so they are only waited out.
+        while True:
+            child = os.waitid(os.P_ALL, 0, os.WEXITED | os.WNOWAIT)
+            if child is not None and child.si_pid in running:
+                return child.si_pid
+            time.sleep(0.01)
+
+    def run(self):
+        try:
+            return self.schedule()
+        except KeyboardInterrupt:
+            # the stages run in sessions of their own and would not see the interrupt
+            self.stop(self.running)
+            raise
+
+    def schedule(self):
+        deps = self.dependencies()
+        pending = list(range(len(self.stages)))
+        running = self.running = {}
+        done = set()
+        failed = set()
+        free = self.cores
+        while pending or running:
+            progress = True
+            while progress:
+                progress = False
+                for i in list(pending):
+                    stage = self.stages[i]
+                    if deps[i] & failed or stage.sample.failed:
+                        pending.remove(i)
+                        failed.add(i)
+                        self.log(stage, ' Skipping '+stage.name+(', the sample failed' if stage.sample.failed else ', a stage it depends on failed'))
+                        self.skipped(stage, 'skipped')
+                        progress = True
+                        continue
+                    if not deps[i] <= done:
+                        continue
+                    cores = min(stage.cores, self.cores)
+                    if cores > free:
+                        continue
+                    pending.remove(i)
+                    progress = True
+                    if stage.sample.checkpoint.is_current(stage.name, stage.inputs, stage.outputs, stage.params):
+                        self.log(stage, 'Inputs and parameters of '+stage.name+' unchanged, reusing its output')
+                        self.skipped(stage, 'reused')
+                        done.add(i)
+                        continue
+                    job = self.launch(stage)
+                    running[job[1].pid] = job
+                    free -= cores
+            if not running:
+                if pending:
+                    raise RuntimeError('stages '+', '.join(self.stages[i].name for i in pending)+' can not be scheduled')
+                break
+            pid = self.wait(running)
+            pid, status, rusage = os.wait4(pid, 0)
+            job = running.pop(pid)
+            stage = job[0]
+            free += min(stage.cores, self.cores)
+            status = os.WEXITSTATUS(status) if os.WIFEXITED(status) else 128 + os.WTERMSIG(status)
+            if self.finished(job, status, rusage):
+                done.add(stage.index)
+                continue
+            failed.add(stage.index)
+            if not stage.fatal:
+                continue
+            if not self.keep_going:
+                self.stop(running)
+                self.save()
+                sys.exit(1)
+            stage.sample.failed = True
+            for other in self.stop(running, stage.sample):
+                failed.add(other.index)
+                free += min(other.cores, self.cores)
+        self.save()
+        return len(failed) == 0